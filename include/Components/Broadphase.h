@@ -0,0 +1,47 @@
+/*Broad-phase geometry used to prune the big-M disjunctions before they reach the MIP.*/
+#pragma once
+#include <functional>
+#include <vector>
+
+// Axis-aligned box given by its lower and upper corner
+struct AABB {
+    double lo[3], hi[3];
+};
+
+// Every placement an object can take: center in [cmin, cmax] and size in [smin, smax] per axis.
+// A fixed box (an obstacle) has cmin == cmax and smin == smax.
+struct BoxRange {
+    double cmin[3], cmax[3], smin[3], smax[3];
+
+    // Union of all placements
+    AABB bounds() const;
+    // Whether some placement puts this box on the given DisjunctionSide of other (touching allowed)
+    bool canBeOnSide(const BoxRange& other, int side) const;
+    // Largest distance by which this box can lie on the given side of other, negative if it never can
+    double maxGap(const BoxRange& other, int side) const;
+    // Largest amount by which "this box is on the given side of other" can be violated, a valid big-M for that row
+    double maxOverlap(const BoxRange& other, int side) const;
+    // Whether every placement of inner is also a placement of this range
+    bool contains(const BoxRange& inner) const;
+};
+
+// Reports every pair i < j whose boxes overlap on each of the first dims axes, sweeping along x.
+// Pairs that are apart on some axis are never reported.
+void sweepAndPrune(const std::vector<AABB>& boxes, int dims, const std::function<void(int, int)>& report);
+
+// Uniform grid over the x/y extent of a fixed set of boxes (obstacles), for overlap queries
+class BoxGrid {
+public:
+    BoxGrid(const std::vector<AABB>& boxes, int dims);
+    // Indices of the boxes that overlap box on each of the first dims axes, ascending
+    void query(const AABB& box, std::vector<int>& result) const;
+
+private:
+    void cellRange(const AABB& box, int& x0, int& x1, int& y0, int& y1) const;
+
+    std::vector<AABB> boxes;
+    int dims;
+    double origin[2], cellSize;
+    int cols, rows;
+    std::vector<std::vector<int>> cells;
+};
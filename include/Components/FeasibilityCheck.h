@@ -0,0 +1,12 @@
+/*Native infeasibility screening of the continuous layout rows, much cheaper than a Gurobi IIS of the whole model.*/
+#pragma once
+#include "ModelBuilder.h"
+#include <vector>
+
+// Rows over the flat box coordinates 6 * id + k (x, y, z, l, w, h per object id) are rewritten on the box faces
+// lo = x - l / 2 and hi = x + l / 2 of each axis, with lo <= hi implied. A row that becomes face - face <= c or
+// face <= c is kept as is, a row on a single center (x >= c) is relaxed to the face it implies (hi >= c), all
+// other rows are skipped. The kept rows form a difference system, which is infeasible iff its constraint graph
+// has a negative cycle; the rows on that cycle are then infeasible on their own.
+// Returns the indices of such rows, ascending, or an empty vector when the screened rows are consistent.
+std::vector<int> infeasibleRows(int numObjects, const std::vector<ModelBuilder::Constr>& rows);
@@ -0,0 +1,14 @@
+/*Minimum-weight feedback arc sets, used to break cycles of relation edges without asking the user.*/
+#pragma once
+#include <vector>
+
+// Weighted arc from -> to between vertices 0..n-1
+struct Arc {
+    int from, to;
+    double weight;
+};
+
+// Indices of arcs whose removal leaves the graph acyclic, ascending. The set is of minimum total weight for
+// graphs of at most exactLimit vertices (dynamic program over vertex subsets); larger graphs use the
+// Eades-Lin-Smyth ordering heuristic in O((n + m) log n). Self loops are always part of the set.
+std::vector<int> feedbackArcSet(int n, const std::vector<Arc>& arcs, int exactLimit = 12);
@@ -1,6 +1,7 @@
 #pragma once
 #include <boost/graph/filtered_graph.hpp>
 #include <boost/graph/strong_components.hpp>
+#include "FeedbackArcSet.h"
 #include "SceneGraph.h"
 #include "InputScene.h"
 #include <map>
@@ -18,6 +19,33 @@ struct EdgeTypeFilter {
     EdgeType type;
 };
 
+// How process() settles the conflicts it finds in the input graph
+enum class ConflictPolicy {
+    Report,         // only describe the conflict in conflict_info/plan_info, the solve is refused
+    DropConstraint, // drop the minimum-weight edges breaking a cycle or the boundary/on-floor/position constraint at fault
+    Relax,          // keep the constraint but weaken it (flip orientation, drop tolerances, move to the floor)
+    DropObject,     // remove the object at fault
+    CostWeighted    // apply the cheapest plan according to GraphProcessor::costs
+};
+
+// Cost of each kind of change, used by ConflictPolicy::CostWeighted
+struct ConflictCosts {
+    double edge = 1;          // per unit of EdgeProperties::weight
+    double orientation = 0.5;
+    double tolerance = 0.5;   // dropping a position tolerance or snapping the height to the floor
+    double position = 1;
+    double boundary = 1;
+    double onFloor = 1;
+    double object = 5;
+};
+
+// One way to settle a conflict; kind is the policy that prefers it
+struct ConflictPlan {
+    std::string description;
+    ConflictPolicy kind;
+    double cost;
+};
+
 class GraphProcessor {
 public:
     GraphProcessor();
@@ -33,13 +61,22 @@ public:
     std::vector<Orientation> orientations;
     std::vector<std::string> orientationnames;
     std::string conflict_info;
+    // Plans of the reported conflict, or the plans applied by a policy other than Report
     std::vector<std::string> plan_info;
+    ConflictPolicy policy = ConflictPolicy::Report;
+    ConflictCosts costs;
 
 private:
+    // Index of the plan the policy applies and records in plan_info, -1 when the conflict is only reported
+    int choosePlan(const std::string& conflict, const std::vector<ConflictPlan>& plans);
+    void resolveCycles(SceneGraph& g, EdgeType edge_type, std::vector<VertexDescriptor>& verticestoremove);
     bool checkOverlap(std::vector<double> r1, std::vector<double> r2);
     bool checkInside(std::vector<double> r, std::vector<double> R);
-    void removeCycles(SceneGraph& g, EdgeType edge_type);
+    void removeCycles(SceneGraph& g, EdgeType edge_type, std::vector<VertexDescriptor>& verticestoremove);
     void checkPositionConstraint(SceneGraph& g, const Boundary& boundary, std::vector<Obstacles> obstacles, std::vector<VertexDescriptor>& verticestoremove);
     Orientation oppositeOrientation(Orientation o);
     EdgeType oppositeEdgeType(EdgeType e);
+
+    // Plans applied by the last process(), reset() keeps them in plan_info
+    std::vector<std::string> applied_plans;
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+/*Native layout heuristic: greedy placement followed by simulated annealing over the object boxes, without a MIP solver.*/
+#pragma once
+#include "Broadphase.h"
+#include "ModelBuilder.h"
+#include <array>
+#include <vector>
+
+// Layout problem over the flat box coordinates 6 * id + k (x, y, z, l, w, h per object id), see Solver::layoutProblem
+struct LayoutProblem {
+    // 2 for floor plans (z and h stay 0), 3 otherwise
+    int dims = 3;
+    // Boundary box, every object stays inside it
+    AABB room;
+    // Reachable centers and sizes per object (tolerances)
+    std::vector<BoxRange> ranges;
+    // -1 free, 0 standing on the floor, 1 hanging from the ceiling
+    std::vector<int> support;
+    // Hard rows: relations and walls
+    std::vector<ModelBuilder::Constr> rows;
+    // Minimized sum of errorWeights[k] * errors[k]^2 + areaWeight * l * w over areaIds
+    std::vector<ModelBuilder::Expr> errors;
+    std::vector<double> errorWeights;
+    std::vector<int> areaIds;
+    double areaWeight = 0;
+    std::vector<AABB> obstacles;
+    // Points the corner (sx, sy) of an object may sit on, empty for objects without a corner constraint
+    std::vector<std::vector<std::array<double, 2>>> corners;
+    std::vector<std::array<double, 2>> cornerSides;
+    // Floor plans: required total area of the objects, negative for none
+    double totalArea = -1;
+    // Starting boxes, e.g. the targets; objects with an empty hint are placed greedily
+    std::vector<std::vector<double>> hints;
+};
+
+struct HeuristicSettings {
+    double timeLimit = 0.2;
+    int maxIterations = 200000;
+    unsigned seed = 1;
+};
+
+struct HeuristicResult {
+    // Summed violation of the hard constraints (in boundary units), 0 for a feasible layout
+    double violation = 0;
+    double objective = 0;
+    int iterations = 0;
+    std::vector<std::array<double, 6>> boxes;
+    bool feasible() const { return violation <= 1e-6; }
+};
+
+// Best feasible layout found within the limits, or the least violating one when none is feasible
+HeuristicResult solveLayoutHeuristic(const LayoutProblem& problem, const HeuristicSettings& settings);
@@ -0,0 +1,38 @@
+/*MIP solvers other than Gurobi: they take the model staged in a ModelBuilder as a whole and return the solution.*/
+#pragma once
+#include "ModelBuilder.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Solver used by Solver::solve(). Gurobi is driven natively (callbacks, IIS, portfolio, incremental resolve),
+// the others through MipBackend.
+enum class MipBackendType { Gurobi, HiGHS };
+
+struct MipSettings {
+    int threads = 0;
+    double timeLimit = 10;
+    double mipGap = 0.01;
+    bool verbose = false;
+};
+
+// Outcome of a backend solve, status uses the Gurobi status codes (GRB_OPTIMAL, GRB_INFEASIBLE, GRB_TIME_LIMIT, ...)
+struct MipResult {
+    int status = GRB_LOADED;
+    int solCount = 0;
+    double objective = 0, bound = 0, mipGap = -1, nodeCount = 0, runtime = 0;
+    // One value per staged variable when solCount > 0
+    std::vector<double> values;
+};
+
+class MipBackend {
+public:
+    virtual ~MipBackend() {}
+    virtual std::string name() const = 0;
+    // start may be empty or hold one value per staged variable. Throws std::runtime_error for models the
+    // backend cannot represent.
+    virtual MipResult solve(const ModelBuilder& model, const MipSettings& settings, const std::vector<double>& start) = 0;
+};
+
+// nullptr when the build has no HiGHS (AUTOHOMEPLAN_WITH_HIGHS undefined)
+std::unique_ptr<MipBackend> makeHighsBackend();
@@ -0,0 +1,116 @@
+/*Staging buffers for the layout MIP: variables and sparse rows are collected in flat arrays and pushed to Gurobi in bulk.*/
+#pragma once
+
+#include <gurobi_c++.h>
+#include <string>
+#include <vector>
+
+class HighsBackend;
+
+class ModelBuilder {
+public:
+    // Handle of a staged variable, its index equals the model index after flush()
+    struct Var {
+        int index = -1;
+        bool valid() const { return index >= 0; }
+    };
+
+    // Linear expression with an inline term buffer, large enough for the fixed-shape layout rows.
+    // Rows with an arbitrary number of terms use beginRow/addTerm/endRow instead.
+    struct Expr {
+        static const int capacity = 8;
+        int size = 0;
+        int vars[capacity];
+        double coeffs[capacity];
+        double constant = 0;
+
+        Expr() {}
+        Expr(double c) : constant(c) {}
+        Expr(Var v) : size(1) { vars[0] = v.index; coeffs[0] = 1; }
+        Expr& operator+=(const Expr& e);
+        Expr& operator-=(const Expr& e);
+        Expr& operator*=(double c);
+    };
+
+    // expr (sense) 0
+    struct Constr {
+        Expr expr;
+        char sense;
+    };
+
+    Var addVar(double lb, double ub, char type, const std::string& name = "");
+    int addConstr(const Constr& c);
+    // Row that only has to hold when the binary bin is 1 (a Gurobi indicator constraint)
+    int addIndicator(Var bin, const Constr& c);
+    void beginRow();
+    void addTerm(Var v, double coeff);
+    int endRow(char sense, double rhs);
+
+    // sum coeffs[k] * first[k] * second[k] (sense) rhs, e.g. the floor plan area constraint
+    void addQuadConstr(const std::vector<Var>& first, const std::vector<Var>& second, const std::vector<double>& coeffs,
+        char sense, double rhs, const std::string& name = "");
+
+    // Minimized objective: constant + linear terms + quadratic terms. clear() keeps it, clearObjective() drops it.
+    void clearObjective();
+    void addObjective(const Expr& e);
+    // coeff * e^2, expanded into linear and quadratic terms
+    void addObjectiveSquare(const Expr& e, double coeff);
+    void addObjectiveProduct(Var a, Var b, double coeff);
+    bool objectiveIsLinear() const { return objQuadCoeffs.empty(); }
+
+    double lowerBound(Var v) const { return lb[v.index]; }
+    double upperBound(Var v) const { return ub[v.index]; }
+    int numVars() const { return lb.size(); }
+    int numRows() const { return senses.size(); }
+    int numIndicators() const { return numIndicatorRows; }
+    int numQuadRows() const { return quadRows.size(); }
+    int numNonzeros() const { return cols.size(); }
+    int numBinaries() const;
+    void reserve(int vars, int rows, int nonzeros);
+    // One addVars call for all staged variables and one addConstrs call for all linear rows; indicator rows are
+    // added one by one as Gurobi has no bulk form for them. Both outputs keep the staging order. rowNames and
+    // indicatorNames may be empty.
+    void flush(GRBModel& model, const std::vector<std::string>& rowNames, const std::vector<std::string>& indicatorNames,
+        std::vector<GRBVar>& vars, std::vector<GRBConstr>& constrs, std::vector<GRBGenConstr>& indicators);
+    // Sets the staged objective on a model flushed before, vars as returned by flush()
+    void flushObjective(GRBModel& model, const std::vector<GRBVar>& vars) const;
+    // Drops the staged variables and rows but keeps the buffer capacity for the next model
+    void clear();
+
+private:
+    // Reads the staged model as a whole instead of flushing it to Gurobi
+    friend class HighsBackend;
+
+    std::vector<double> lb, ub;
+    std::vector<char> types;
+    std::vector<std::string> varNames;
+    // Rows in compressed sparse row form
+    std::vector<int> rowBegin, cols;
+    std::vector<double> coeffs, rhs;
+    std::vector<char> senses;
+    // Binary of each row, -1 for plain linear rows
+    std::vector<int> rowIndicator;
+    int numIndicatorRows = 0;
+    // Quadratic rows, one term list each
+    struct QuadRow {
+        std::vector<int> first, second;
+        std::vector<double> coeffs;
+        char sense;
+        double rhs;
+        std::string name;
+    };
+    std::vector<QuadRow> quadRows;
+    double objConstant = 0;
+    std::vector<int> objCols, objFirst, objSecond;
+    std::vector<double> objCoeffs, objQuadCoeffs;
+};
+
+inline ModelBuilder::Expr operator+(ModelBuilder::Expr a, const ModelBuilder::Expr& b) { return a += b; }
+inline ModelBuilder::Expr operator-(ModelBuilder::Expr a, const ModelBuilder::Expr& b) { return a -= b; }
+inline ModelBuilder::Expr operator-(ModelBuilder::Expr a) { return a *= -1; }
+inline ModelBuilder::Expr operator*(double c, ModelBuilder::Expr a) { return a *= c; }
+inline ModelBuilder::Expr operator*(ModelBuilder::Expr a, double c) { return a *= c; }
+inline ModelBuilder::Expr operator/(ModelBuilder::Expr a, double c) { return a *= 1 / c; }
+inline ModelBuilder::Constr operator<=(const ModelBuilder::Expr& a, const ModelBuilder::Expr& b) { return { a - b, GRB_LESS_EQUAL }; }
+inline ModelBuilder::Constr operator>=(const ModelBuilder::Expr& a, const ModelBuilder::Expr& b) { return { a - b, GRB_GREATER_EQUAL }; }
+inline ModelBuilder::Constr operator==(const ModelBuilder::Expr& a, const ModelBuilder::Expr& b) { return { a - b, GRB_EQUAL }; }
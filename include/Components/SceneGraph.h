@@ -18,6 +18,9 @@ struct VertexProperties {
 	std::vector<double> target_pos, target_size, pos, size, pos_tolerance, size_tolerance;
 	Orientation orientation;
 	bool on_floor, hanging;
+	// Position of the object in the input "vertices" array; kept when conflict plans remove objects and renumber
+	// ids, and shared by the halves of a split floor plan room
+	int input_index = -1;
 };
 
 struct EdgeProperties {
@@ -27,6 +30,8 @@ struct EdgeProperties {
 	// Notice that align_edge = {0, 1, 2, 3}, each number represents the alignment of bottom/right/up/left ,respectively.
 	int align_edge;
 	EdgeType type;
+	// Importance of the relation, the conflict resolution drops low-weight edges first
+	double weight = 1;
 };
 
 typedef boost::adjacency_list<
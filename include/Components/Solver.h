@@ -1,9 +1,20 @@
 #pragma once
 
+#include "Broadphase.h"
 #include "GraphProcessor.h"
+#include "FeasibilityCheck.h"
+#include "LayoutHeuristic.h"
+#include "MipBackend.h"
+#include "ModelBuilder.h"
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <boost/graph/graphviz.hpp>
+#include <cstdint>
 #include <fstream>
 #include <gurobi_c++.h>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <polyclipping/clipper.hpp>
 
@@ -77,40 +88,341 @@ struct edge_writer {
     const SceneGraph& g;
 };
 
+// Family of a linear layout constraint, see Solver::constraintName for the naming scheme
+enum class ConstraintKind : std::uint8_t {
+    Inside, PosTolerance, SizeTolerance, OnFloor, Hanging, Relation, CloseBy, NonOverlap, Obstacle, Boundary, Corner, Symmetry,
+    // ObjectiveMode::Linear only: bounds of the absolute error variables and the McCormick area rows
+    ObjectiveError, Area
+};
+
+// Compact description of a constraint. first is the object id; second is the other object id, the obstacle
+// index, the wall orientation or the corner type depending on kind; part is the axis/side (the EdgeType for relations).
+struct ConstraintTag {
+    ConstraintKind kind;
+    int first, second;
+    int part;
+};
+
+// Side of the first box relative to the second one, used to index DisjunctionPair::sigma
+enum DisjunctionSide { SideRight, SideLeft, SideFront, SideBack, SideAbove, SideBelow };
+
+// Disjunction between two objects (second is an object id) or an object and an obstacle (second is the
+// obstacle index). sigma holds the model index of the binary of each side, -1 if the side has none.
+struct DisjunctionPair {
+    int first, second;
+    int sigma[6];
+};
+
+// Object non-overlap disjunction kept out of the model until an incumbent overlaps the pair, see
+// Solver::lazyNonOverlap. The side binaries exist from the start, M holds the big-M of each side row.
+struct LazyDisjunction {
+    DisjunctionPair pair;
+    unsigned sides;
+    double M[6];
+    // 0: not in the model, 1: added by the callback of the running optimize, 2: added to the model
+    int state;
+};
+
+// Formulation of the non-overlap, obstacle and CloseBy disjunctions: big-M rows with per-pair M computed
+// from the reachable boxes, or Gurobi indicator constraints on the side binaries
+enum class DisjunctionMode { BigM, Indicator };
+
+// Squared errors and exact l * w areas (a MIQP, with a nonconvex quadratic area row for floor plans), or
+// absolute errors and piecewise McCormick areas so that the whole model is a MILP
+enum class ObjectiveMode { Quadratic, Linear };
+
+// Error of the objective: hyperparameters[weight] * (error / scale)^2, or |error| / scale in linear mode,
+// averaged over the objects/edges contributing to that weight
+struct ObjectiveTerm {
+    ModelBuilder::Expr error;
+    int weight;
+    double scale;
+};
+
+// Timings in seconds and model sizes of the last readSceneGraph/solve, written to the "stats" block of output.json
+struct SolveStats {
+    // readSceneGraph: JSON parsing, Clipper wall offset, GraphProcessor::process (and splitGraph2)
+    double parseTime = 0, clipperTime = 0, processTime = 0;
+    // solve: has_path filtering of the non-overlap pairs (part of buildTime), addConstraints, MIP start,
+    // optimization (all strategies), IIS handling and saveGraph up to writing the file
+    double pairFilterTime = 0, buildTime = 0, warmStartTime = 0, optimizeTime = 0, iisTime = 0, saveTime = 0;
+    // Layout heuristic runs (preview, MIP start, fallback), the MIP start part is also in warmStartTime
+    double heuristicTime = 0;
+    int numVars = 0, numBinVars = 0, numConstrs = 0, numQConstrs = 0, numGenConstrs = 0, numNZs = 0, numQNZs = 0;
+    int candidatePairs = 0, nonOverlapPairs = 0, obstaclePairs = 0;
+    // Solver::lazyNonOverlap: pairs whose disjunction was added because an incumbent overlapped them
+    int lazyPairs = 0;
+    // Result of the optimization that produced the solution; mipGap and objective are -1 without one
+    int status = 0, solCount = 0;
+    double nodeCount = 0, mipGap = -1, runtime = 0, objective = -1;
+    // The stored layout comes from the heuristic (preview() or the fallback), not from the MIP
+    bool heuristic = false;
+
+    nlohmann::json toJson() const;
+};
+
+// Latest incumbent published while Gurobi runs, see Solver::streamIncumbents
+struct IncumbentSnapshot {
+    // Increases with every published incumbent over the lifetime of the Solver, 0 before the first one
+    int version = 0;
+    double objective = 0, bound = 0, runtime = 0;
+    // Scene graph of the running solve with pos/size set from the incumbent
+    SceneGraph graph;
+};
+
+// State of the optimization in progress, see Solver::getprogress
+struct SolveProgress {
+    double runtime = 0;
+    // Best objective and bound of the running MIP, GRB_INFINITY / -GRB_INFINITY while unknown
+    double objective = GRB_INFINITY, bound = -GRB_INFINITY;
+    int solutions = 0;
+    double nodes = 0;
+};
+
+class SolveCallback;
+
 class Solver {
 public:
     Solver();
     ~Solver();
 
     void solve();
+    // Layout from the heuristic only, in milliseconds and without a MIP solver; stored and saved like solve()
+    void preview();
+    // Re-optimize after the update* calls below, editing the existing model and starting from the last solution.
+    // Falls back to a full solve() when no model was built yet or an update changed the model structure.
+    void resolve();
+    // Delta updates on the current scene graph, ids as in getsolution(). They return false when the object/edge
+    // is unknown or the change needs a rebuild (e.g. adding a target that had none), resolve() handles the latter.
+    bool updateTargetSize(int id, const std::vector<double>& target_size);
+    bool updateTargetPos(int id, const std::vector<double>& target_pos);
+    bool updateEdgeDistance(int source_id, int target_id, EdgeType type, double distance);
     void saveGraph();
     void readSceneGraph(const std::string& path, float wallwidth);
     void reset();
     SceneGraph getsolution() { return g; }
     float getboundaryMaxSize();
     Boundary getboundary() { return boundary; }
+    std::string getconflictinfo() { return graphProcessor.conflict_info; }
+    SolveStats getstats() { return stats; }
+    // Copies the latest incumbent into snapshot if it is newer than snapshot.version; safe to call from any thread
+    bool getincumbent(IncumbentSnapshot& snapshot);
+    SolveProgress getprogress();
+    // Stops a solve running on another thread; it keeps the best solution found so far and skips the IIS loop
+    void cancel();
+    bool cancelled() const { return cancelFlag->load(); }
 
     bool floorplan;
     std::vector<double> hyperparameters;
     int scalingFactor;
+    // Where saveGraph writes the solution, empty means Assets/SceneGraph/output.json
+    std::string outputpath;
+    // Write graph_in.dot, graph_out.dot and model.lp to Assets/SceneGraph
+    bool saveDebugFiles;
+    // Print the scene graph, variable values and the Gurobi log to stdout
+    bool verbose;
+    // Gurobi Threads parameter, 0 lets Gurobi decide
+    int threads;
+    // Name every constraint in the model (readable model.lp); otherwise names are only built for IIS reports
+    bool nameConstraints;
+    // Seed the MIP start from the last solved pos/size, or target_pos/target_size when there is none
+    bool warmStart;
+    // Time limit of one solve in seconds, shared by the coarse or cluster models, the fine or reconciliation
+    // model and the fallback to the full model, which get whatever the earlier stages left
+    double timeLimit;
+    // Skip or fix disjunctions that the target_pos/target_size tolerance boxes already decide
+    bool pruneDisjunctions;
+    DisjunctionMode disjunctionMode;
+    // Order interchangeable objects (same properties and same edges) by x to cut permuted solutions
+    bool breakSymmetry;
+    // Solve the connected components of the relation graph as separate MIPs on threads, then reconcile them
+    // in the full model with only the disjunctions between components left free. Ignored for floor plans.
+    bool decompose;
+    // Floor plans: solve the unsplit rooms first, then the split rectangles bounded to their room's coarse box
+    bool coarseToFine;
+    // How far a split rectangle may leave its room's coarse box, as a fraction of the boundary size
+    double coarseMargin;
+    // Number of Gurobi parameter sets raced on separate threads, the first to reach the MIP gap wins;
+    // 0 or 1 solves with the single default set
+    int portfolio;
+    // Publish every improving incumbent into the snapshot of getincumbent() while Gurobi runs
+    bool streamIncumbents;
+    // Also append each incumbent as one JSON line to this file (headless use), empty for none
+    std::string incumbentStreamPath;
+    // How conflicts in the input graph are settled when it is read; Report refuses the solve and lists the plans
+    ConflictPolicy conflictPolicy;
+    ConflictCosts conflictCosts;
+    // MIP solver; the decomposed, two-level and portfolio solves, incumbent streaming and the IIS report need Gurobi
+    MipBackendType backend;
+    // Linear turns the model into a MILP, always used by the HiGHS backend; every update* then rebuilds the model
+    ObjectiveMode objectiveMode;
+    // Linear mode: pieces of each object's length range in the area approximation, 1 is the plain McCormick envelope
+    int areaSegments;
+    // Gurobi only: add the object non-overlap rows from the callback when an incumbent overlaps a pair, instead of
+    // all of them up front. The rows are big-M regardless of disjunctionMode, and the portfolio is not raced.
+    bool lazyNonOverlap;
+    // Start the MIP from the heuristic layout for objects that have no solved pos/size yet
+    bool heuristicStart;
+    // Keep a feasible heuristic layout when the MIP ends without a solution (time limit, cancel, backend error)
+    bool heuristicFallback;
+    // Time limit of a heuristic run in seconds
+    double heuristicTimeLimit;
+    // Screen an infeasible model natively (faces, tolerances, walls, corner spans, relation chains) before the
+    // Gurobi IIS, which only runs when the screening finds nothing
+    bool iisPrecheck;
 private:
-    bool has_path(const SceneGraph& g, VertexDescriptor start, VertexDescriptor target);
-    bool dfs_check_path(const SceneGraph& g, VertexDescriptor u, VertexDescriptor target, EdgeType required_type, std::vector<bool>& visited);
+    friend class SolveCallback;
+    void findSymmetryClasses();
+    bool inSymmetryClass(int id) const;
+    void buildReachability();
+    bool has_path(int source_id, int target_id) const;
     void addConstraints();
+    // Relation row of an edge over the given box handles, false for CloseBy (a disjunction) and unknown relations
+    bool relationRow(const EdgeProperties& ep, int ids, int idt, const std::vector<std::array<ModelBuilder::Var, 6>>& box,
+        ModelBuilder::Constr& row) const;
+    // Wall contact row and the two rows keeping the object along the wall, false when vp is not on a wall
+    bool wallRows(const VertexProperties& vp, const std::array<ModelBuilder::Var, 6>& box, ModelBuilder::Constr rows[3]) const;
+    // Bitmask of DisjunctionSide values
+    unsigned allSides() const;
+    unsigned feasibleSides(const BoxRange& a, const BoxRange& b) const;
+    BoxRange objectRange(const VertexProperties& vp) const;
+    // Boxes are x, y, z, l, w, h; only the sides in the mask get a row
+    DisjunctionPair addDisjunction(ConstraintKind kind, int first, int second, const std::array<ModelBuilder::Expr, 6>& a,
+        const std::array<ModelBuilder::Expr, 6>& b, const BoxRange& ra, const BoxRange& rb, unsigned sides);
+    // Error terms over the given box handles, ids whose area is rewarded, and the number of objects/edges per weight
+    void collectObjective(const std::vector<std::array<ModelBuilder::Var, 6>>& box, std::vector<ObjectiveTerm>& terms,
+        std::vector<int>& area_ids, std::array<int, 4>& counts) const;
+    // Linear mode: variable enclosing l * w of the object, exact at the ends of each length segment
+    ModelBuilder::Var addAreaVar(int id, const BoxRange& range);
+    // lazyNonOverlap: creates the binaries of the pair and records its rows in lazyPairs
+    DisjunctionPair addLazyDisjunction(int first, int second, const BoxRange& ra, const BoxRange& rb, unsigned sides);
+    void lazyDisjunctionRows(const LazyDisjunction& lazy, std::vector<ModelBuilder::Constr>& rows, std::vector<ConstraintTag>& tags) const;
+    // Rows of the pending disjunctions whose boxes overlap in the solution, called from the MIPSOL callback
+    void separateOverlaps(const std::vector<double>& values, std::vector<ModelBuilder::Constr>& rows);
+    // Adds the disjunctions cut during the last optimize to the model, so later optimizes and the IIS keep them
+    void commitLazyRows();
+    GRBLinExpr linExpr(const ModelBuilder::Expr& e) const;
+    void buildObjective();
+    // The current scene graph as a heuristic problem over the flat box coordinates
+    LayoutProblem layoutProblem() const;
+    HeuristicResult runHeuristic();
+    // Writes the heuristic boxes into g
+    void storeHeuristic(const HeuristicResult& result);
+    // Stores a feasible heuristic layout when the MIP ended without a solution and without a conflict
+    void heuristicFallbackSolve();
+    // Start box of an object from its solved or target pos/size, clamped into the boundary and the tolerances
+    std::vector<double> hintBox(const VertexProperties& vp) const;
+    // start holds optional start boxes per object id (x, y, z, l, w, h) that take the place of pos/size
+    void setWarmStart(const std::vector<std::vector<double>>& start = {});
+    // Seconds left of timeLimit since solveStart
+    double remainingTime() const;
+    // Copies the options, boundary and obstacles into a Solver used for a partial model
+    void configureSubSolver(Solver& sub) const;
+    // Installs a callback on the model of a sub-solver that stops it on cancel() and reports its progress here
+    void watchSubSolver(Solver& sub);
+    // Two-level floor plan solve of the built model, false when no solution was found
+    bool solveCoarseToFine();
+    // Cluster of every object id, empty when the relation graph is connected
+    std::vector<int> findClusters(int max_clusters) const;
+    // Decomposed solve of the built model, false when it does not apply or found no solution
+    bool solveClusters();
+    void setParameters(GRBModel& target) const;
+    // Portfolio solve of the model, false when no configuration found a solution
+    bool racePortfolio();
     void optimizeModel();
+    // Solves the staged model with a backend other than Gurobi
+    void solveWithBackend();
+    // Copies the incumbent of the model, or a solution in model variable order, into g and lastSolution
+    void storeSolution();
+    void storeSolution(const std::vector<double>& values, double objective);
+    // Sets pos/size of the vertices of graph from a solution in model variable order
+    void writeBoxes(SceneGraph& graph, const std::vector<double>& values) const;
+    // Called from the Gurobi callbacks, keeps the incumbent only if it improves the published one
+    void publishIncumbent(const std::vector<double>& values, double objective, double bound, double runtime);
+    void publishProgress(double runtime, double objective, double bound, double nodes, int solutions);
+    // Installs the callback on the current model and starts a new incumbent stream and progress,
+    // append continues the JSON lines file
+    void beginIncumbentStream(bool append);
+    // Status, node count, gap and runtime of the optimization whose solution is kept
+    void recordResult(GRBModel& optimized);
     void handleInfeasibleModel();
-    void removeIIS(std::string name);
+    // Continuous rows of the model over the flat box coordinates 6 * id + k, with the tags of the rows they stand for
+    void screeningRows(std::vector<ModelBuilder::Constr>& rows, std::vector<ConstraintTag>& tags) const;
+    // Lists an infeasible subset found by infeasibleRows in conflict_info/plan_info, false when there is none
+    bool screenInfeasibility();
+    void removeIIS(const ConstraintTag& tag);
     void clearModel();
+    GRBVar modelVar(int index) const;
+    VertexDescriptor findVertex(const SceneGraph& graph, int id) const;
+    // Vertex of inputGraph that object id of g was read from; ids in g are renumbered after a DropObject plan
+    VertexDescriptor inputVertex(int id) const;
+    bool updateTolerance(ConstraintKind kind, int id, const std::vector<double>& target, const std::vector<double>& tolerance);
+    void addConstr(const ModelBuilder::Constr& constr, const ConstraintTag& tag);
+    void addIndicator(ModelBuilder::Var bin, const ModelBuilder::Constr& constr, const ConstraintTag& tag);
+    // Finishes the row started with builder.beginRow()
+    void addRow(char sense, double rhs, const ConstraintTag& tag);
+    std::string constraintName(const ConstraintTag& tag) const;
 
     SceneGraph inputGraph, g;
+    // Floor plans: the processed graph before splitGraph2, one vertex per room
+    SceneGraph roomGraph;
     Boundary boundary;
     std::vector<Obstacles> obstacles;
     std::vector<Doors> doors;
     std::vector<Windows> windows;
     GraphProcessor graphProcessor;
 
-    GRBEnv env;
-    GRBModel model;
+    // Transitive closure of the directional relations (LeftOf ... Under), one bitset row per
+    // (edge type, vertex id) with reachabilityWords 64-bit words per row, rebuilt once per solve.
+    std::vector<std::uint64_t> reachability;
+    int reachabilityWords;
+
+    // Staging buffers of addConstraints, kept to reuse their capacity
+    ModelBuilder builder;
+    // Linear constraints of the model and their tags, in the order they were added
+    std::vector<GRBConstr> constraints;
+    std::vector<ConstraintTag> constraintTags;
+    // Indicator constraints (DisjunctionMode::Indicator) and their tags
+    std::vector<GRBGenConstr> indicatorConstraints;
+    std::vector<ConstraintTag> indicatorTags;
+
+    // Position and size variables indexed by object id, z/h are unset in floorplan mode
+    std::vector<GRBVar> x_i, y_i, z_i, l_i, w_i, h_i;
+    // The same variables as staged handles (x, y, z, l, w, h), valid for every backend
+    std::vector<std::array<ModelBuilder::Var, 6>> boxVars;
+    // Linear mode: |error| of every collectObjective term, and the area of each object id (invalid when unused)
+    std::vector<ModelBuilder::Var> errorVars, areaVars;
+    // Classes of interchangeable object ids in ascending order, and the class of each id (-1 for none)
+    std::vector<std::vector<int>> symmetryClasses;
+    std::vector<int> symmetryClassOf;
+    // All model variables by index, as returned by the bulk insert
+    std::vector<GRBVar> vars;
+    // Only the pairs that actually got a disjunction, instead of dense n x n / n x obstacles tables
+    std::vector<DisjunctionPair> nonOverlapPairs, obstaclePairs;
+    std::vector<LazyDisjunction> lazyPairs;
+    // Values of all model variables after the last successful optimize, used as MIP start by resolve()
+    std::vector<double> lastSolution;
+    bool modelBuilt, needsRebuild;
+    // Objective of the built model: objectiveMode, or Linear for the HiGHS backend, which takes MILPs only
+    ObjectiveMode modelObjective;
+
+    // Created on the first Gurobi solve, so other backends run without a Gurobi license
+    std::unique_ptr<GRBEnv> env;
+    std::unique_ptr<GRBModel> model;
 
     std::string inputpath;
+    SolveStats stats;
+
+    std::unique_ptr<SolveCallback> solveCallback;
+    std::mutex incumbentMutex;
+    IncumbentSnapshot incumbent;
+    // Incumbents published by the current solve, the snapshot only takes improving ones
+    int incumbentCount;
+    std::ofstream incumbentStream;
+    SolveProgress progress;
+    // Start of the current solve(), resolve() or sub-solve, timeLimit is counted from here
+    std::chrono::steady_clock::time_point solveStart;
+    // Set by cancel(); sub-solvers of a decomposed or two-level solve point cancelFlag at the one of their parent
+    std::atomic<bool> cancelRequested;
+    std::atomic<bool>* cancelFlag;
 };
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <future>
 #include <string>
 #include <iostream>
 #include "view/SceneViewer.h"
@@ -53,6 +54,9 @@ private:
 
     SceneViewer scene_viewer_;           // Scene viewer object.
     Solver solver_;                     // Solver object.
+    IncumbentSnapshot incumbent_;       // Last incumbent drawn while solving.
+    std::future<void> solve_job_;       // Solve running on a worker thread, invalid when idle.
+    double solve_start_ = 0.0;          // glfwGetTime() when the running solve started.
 
     Camera camera;
     float lastX;
@@ -0,0 +1,289 @@
+/*Headless batch driver: solves many scene graph JSON files in parallel without OpenGL/GLFW/ImGui.*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Components/Solver.h"
+
+namespace fs = std::filesystem;
+
+struct BatchOptions {
+    int workers = 0;
+    int threadsPerSolve = 0;
+    float wallWidth = 0.02f;
+    double timeLimit = 10;
+    bool warmStart = true;
+    bool decompose = false;
+    bool coarseToFine = true;
+    int portfolio = 0;
+    bool stream = false;
+    ConflictPolicy conflictPolicy = ConflictPolicy::Report;
+    MipBackendType backend = MipBackendType::Gurobi;
+    bool linear = false;
+    bool lazy = false;
+    bool preview = false;
+    bool heuristicStart = false;
+    bool verbose = false;
+    std::vector<std::string> inputs;
+};
+
+static void printUsage(const char* exe)
+{
+    std::cout << "Usage: " << exe << " [options] <scene.json | directory | manifest.txt>...\n"
+              << "  -j, --workers N       number of parallel solves (default: hardware threads)\n"
+              << "  -t, --threads N       Gurobi threads per solve (default: hardware threads / workers)\n"
+              << "  -w, --wall-width W    wall width used for interior scenes (default: 0.02)\n"
+              << "  -T, --time-limit S    time limit per solve in seconds, shared by all MIP stages (default: 10)\n"
+              << "      --cold-start      do not seed the MIP start from target positions/sizes\n"
+              << "      --decompose       solve unrelated object groups as separate MIPs, then reconcile them\n"
+              << "      --single-level    solve split floor plan rooms directly, without the coarse room solve\n"
+              << "  -p, --portfolio N     race N Gurobi parameter sets per solve, the first to reach the gap wins\n"
+              << "      --conflicts P     settle input conflicts with policy P: report (default, the scene is not solved),\n"
+              << "                        constraint, relax, object or cost; applied plans are listed in plan_info\n"
+              << "      --stream          write every improving incumbent to <name>_incumbents.jsonl\n"
+              << "      --backend B       MIP solver: gurobi (default) or highs; highs needs no Gurobi license but\n"
+              << "                        ignores --decompose, --portfolio and --stream and reports no IIS\n"
+              << "      --linear          absolute errors and McCormick areas instead of squares, a MILP (implied by highs)\n"
+              << "      --lazy            add object non-overlap constraints only for pairs an incumbent overlaps\n"
+              << "      --preview         heuristic layout only, no MIP solve (milliseconds per scene, may violate constraints)\n"
+              << "      --heuristic-start start the MIP from the heuristic layout instead of the targets\n"
+              << "  -v, --verbose         print scene graphs and the Gurobi log\n"
+              << "A directory is scanned recursively for *.json, a manifest lists one path per line.\n"
+              << "Each result is written next to its input as <name>_output.json." << std::endl;
+}
+
+static ConflictPolicy parseConflictPolicy(const std::string& name)
+{
+    if (name == "report")
+        return ConflictPolicy::Report;
+    if (name == "constraint")
+        return ConflictPolicy::DropConstraint;
+    if (name == "relax")
+        return ConflictPolicy::Relax;
+    if (name == "object")
+        return ConflictPolicy::DropObject;
+    if (name == "cost")
+        return ConflictPolicy::CostWeighted;
+    throw std::runtime_error("Unknown conflict policy " + name);
+}
+
+static MipBackendType parseBackend(const std::string& name)
+{
+    if (name == "gurobi")
+        return MipBackendType::Gurobi;
+    if (name == "highs")
+        return MipBackendType::HiGHS;
+    throw std::runtime_error("Unknown backend " + name);
+}
+
+static bool isOutputFile(const fs::path& p)
+{
+    std::string name = p.filename().string();
+    const std::string suffix = "output.json";
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+static void collectInputs(const std::string& arg, std::vector<fs::path>& files)
+{
+    fs::path p(arg);
+    if (fs::is_directory(p)) {
+        std::vector<fs::path> found;
+        for (const auto& entry : fs::recursive_directory_iterator(p)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".json" && !isOutputFile(entry.path()))
+                found.push_back(entry.path());
+        }
+        std::sort(found.begin(), found.end());
+        files.insert(files.end(), found.begin(), found.end());
+    }
+    else if (p.extension() == ".json") {
+        files.push_back(p);
+    }
+    else {
+        // Manifest: one scene graph path per line, relative paths are resolved against the manifest
+        std::ifstream manifest(p);
+        if (!manifest.is_open()) {
+            std::cerr << "Failed to open manifest: " << arg << std::endl;
+            return;
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty() || line[0] == '#')
+                continue;
+            fs::path entry(line);
+            files.push_back(entry.is_absolute() ? entry : p.parent_path() / entry);
+        }
+    }
+}
+
+static fs::path outputPathFor(const fs::path& input)
+{
+    return input.parent_path() / (input.stem().string() + "_output.json");
+}
+
+int main(int argc, char** argv)
+{
+    BatchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](const char* name) -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::string("Missing value for ") + name);
+            return argv[++i];
+        };
+        try {
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            }
+            else if (arg == "-j" || arg == "--workers")
+                options.workers = std::stoi(next("--workers"));
+            else if (arg == "-t" || arg == "--threads")
+                options.threadsPerSolve = std::stoi(next("--threads"));
+            else if (arg == "-w" || arg == "--wall-width")
+                options.wallWidth = std::stof(next("--wall-width"));
+            else if (arg == "-T" || arg == "--time-limit")
+                options.timeLimit = std::stod(next("--time-limit"));
+            else if (arg == "--cold-start")
+                options.warmStart = false;
+            else if (arg == "--decompose")
+                options.decompose = true;
+            else if (arg == "--single-level")
+                options.coarseToFine = false;
+            else if (arg == "-p" || arg == "--portfolio")
+                options.portfolio = std::stoi(next("--portfolio"));
+            else if (arg == "--conflicts")
+                options.conflictPolicy = parseConflictPolicy(next("--conflicts"));
+            else if (arg == "--stream")
+                options.stream = true;
+            else if (arg == "--backend") {
+                options.backend = parseBackend(next("--backend"));
+                // HiGHS solves MILPs only
+                if (options.backend != MipBackendType::Gurobi)
+                    options.linear = true;
+            }
+            else if (arg == "--linear")
+                options.linear = true;
+            else if (arg == "--lazy")
+                options.lazy = true;
+            else if (arg == "--preview")
+                options.preview = true;
+            else if (arg == "--heuristic-start")
+                options.heuristicStart = true;
+            else if (arg == "-v" || arg == "--verbose")
+                options.verbose = true;
+            else
+                options.inputs.push_back(arg);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.inputs.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<fs::path> files;
+    for (const auto& input : options.inputs)
+        collectInputs(input, files);
+    if (files.empty()) {
+        std::cerr << "No scene graph files found." << std::endl;
+        return 1;
+    }
+
+    int hardware = std::max(1u, std::thread::hardware_concurrency());
+    int workers = options.workers > 0 ? options.workers : hardware;
+    workers = std::min<int>(workers, files.size());
+    int threadsPerSolve = options.threadsPerSolve > 0 ? options.threadsPerSolve : std::max(1, hardware / workers);
+
+    std::atomic<size_t> nextFile{ 0 };
+    std::atomic<int> solved{ 0 }, conflicts{ 0 }, unsolved{ 0 }, failed{ 0 };
+    std::mutex logMutex;
+
+    auto worker = [&]() {
+        // Every worker owns its Solver and therefore its own GRBEnv/GRBModel
+        std::unique_ptr<Solver> solver = std::make_unique<Solver>();
+        solver->verbose = options.verbose;
+        solver->saveDebugFiles = false;
+        solver->nameConstraints = false;
+        solver->threads = threadsPerSolve;
+        solver->timeLimit = options.timeLimit;
+        solver->warmStart = options.warmStart;
+        solver->decompose = options.decompose;
+        solver->coarseToFine = options.coarseToFine;
+        solver->portfolio = options.portfolio;
+        solver->streamIncumbents = options.stream;
+        solver->conflictPolicy = options.conflictPolicy;
+        solver->backend = options.backend;
+        solver->objectiveMode = options.linear ? ObjectiveMode::Linear : ObjectiveMode::Quadratic;
+        solver->lazyNonOverlap = options.lazy;
+        solver->heuristicStart = options.heuristicStart;
+
+        for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+            const fs::path& input = files[i];
+            auto start = std::chrono::steady_clock::now();
+            std::string status;
+            try {
+                solver->readSceneGraph(input.string(), options.wallWidth);
+                solver->outputpath = outputPathFor(input).string();
+                if (options.stream)
+                    solver->incumbentStreamPath = (input.parent_path() / (input.stem().string() + "_incumbents.jsonl")).string();
+                if (options.preview)
+                    solver->preview();
+                else
+                    solver->solve();
+                // A timed out or cancelled solve ends without a layout unless the heuristic stored one
+                if (!solver->getconflictinfo().empty()) {
+                    status = "conflict";
+                    conflicts++;
+                }
+                else if (solver->getstats().solCount > 0 || solver->getstats().heuristic) {
+                    status = "solved";
+                    solved++;
+                }
+                else {
+                    status = "no_solution";
+                    unsolved++;
+                }
+            }
+            catch (GRBException& e) {
+                status = "failed (Gurobi error " + std::to_string(e.getErrorCode()) + ": " + e.getMessage() + ")";
+                failed++;
+            }
+            catch (const std::exception& e) {
+                status = std::string("failed (") + e.what() + ")";
+                failed++;
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout << "[" << i + 1 << "/" << files.size() << "] " << input.string() << ": " << status
+                      << " in " << seconds << " s" << std::endl;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i)
+        pool.emplace_back(worker);
+    for (auto& t : pool)
+        t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << files.size() << " scene graphs in " << seconds << " s with " << workers << " workers: "
+              << solved << " solved, " << conflicts << " with conflicts, " << unsolved << " without solution, "
+              << failed << " failed" << std::endl;
+    return (unsolved > 0 || failed > 0 || solved + conflicts + unsolved + failed < (int)files.size()) ? 1 : 0;
+}
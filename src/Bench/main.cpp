@@ -0,0 +1,426 @@
+/*Benchmark driver: solves synthetic scene graphs over a parameter sweep plus the shipped samples, and reports
+build/solve times, memory and solution quality as CSV and JSON.*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+#include "Components/Solver.h"
+
+namespace fs = std::filesystem;
+
+struct BenchOptions {
+    std::vector<int> objects = { 5, 10, 20 };
+    std::vector<int> obstacles = { 0, 2 };
+    std::vector<double> density = { 0.5 };
+    std::vector<int> notches = { 0, 2 };
+    bool solve3d = true;
+    bool solveFloorplan = true;
+    int repeat = 1;
+    unsigned seed = 1;
+    int threads = 0;
+    double timeLimit = 10;
+    float wallWidth = 0.02f;
+    bool baselines = true;
+    bool decompose = false;
+    int portfolio = 0;
+    std::string csvPath = "bench.csv";
+    std::string jsonPath = "bench.json";
+    std::string workDir;
+};
+
+// One generated scene of the sweep
+struct SceneSpec {
+    int objects, obstacles, notches;
+    double density;
+    bool floorplan;
+    unsigned seed;
+
+    std::string name() const
+    {
+        std::ostringstream out;
+        out << (floorplan ? "fp" : "3d") << "_n" << objects << "_m" << obstacles << "_d" << density << "_k" << notches << "_s" << seed;
+        return out.str();
+    }
+};
+
+static void printUsage(const char* exe)
+{
+    std::cout << "Usage: " << exe << " [options]\n"
+              << "  -n, --objects LIST    object counts of the sweep (default: 5,10,20)\n"
+              << "  -m, --obstacles LIST  obstacle counts (default: 0,2)\n"
+              << "  -d, --density LIST    relation edges per object (default: 0.5)\n"
+              << "  -k, --notches LIST    corners cut out of the rectangular boundary, 0-4 (default: 0,2)\n"
+              << "      --mode MODE       3d, floorplan or both (default: both)\n"
+              << "  -r, --repeat R        scenes per parameter combination, with consecutive seeds (default: 1)\n"
+              << "  -s, --seed S          first seed (default: 1)\n"
+              << "  -t, --threads N       Gurobi threads (default: Gurobi decides)\n"
+              << "  -T, --time-limit S    time limit per solve in seconds, shared by all MIP stages (default: 10)\n"
+              << "      --decompose       use the decomposed cluster solve\n"
+              << "  -p, --portfolio N     race N Gurobi parameter sets per solve\n"
+              << "      --no-baselines    skip test.json, test2.json and conflict.json\n"
+              << "      --csv PATH        CSV report (default: bench.csv)\n"
+              << "      --json PATH       JSON report (default: bench.json)\n"
+              << "      --work-dir DIR    where generated scenes and outputs go (default: temp directory)\n";
+}
+
+template <class T>
+static std::vector<T> parseList(const std::string& text)
+{
+    std::vector<T> values;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        std::stringstream value(item);
+        T v;
+        if (!(value >> v))
+            throw std::runtime_error("Invalid list: " + text);
+        values.push_back(v);
+    }
+    if (values.empty())
+        throw std::runtime_error("Empty list");
+    return values;
+}
+
+// Counter-clockwise rectilinear boundary: the unit square scaled to size with the first notches corners cut
+// out as rectangles, the shape readSceneGraph turns into boundary obstacles with Clipper
+static std::vector<std::vector<double>> boundaryPoints(double sx, double sy, int notches, std::mt19937& gen)
+{
+    std::uniform_real_distribution<double> cut(0.15, 0.35);
+    // Corners in counter-clockwise order: bottom left, bottom right, top right, top left
+    const double corners[4][2] = { { 0, 0 }, { sx, 0 }, { sx, sy }, { 0, sy } };
+    std::vector<std::vector<double>> points;
+    for (int c = 0; c < 4; ++c) {
+        const double* p = corners[c];
+        if (c >= notches) {
+            points.push_back({ p[0], p[1] });
+            continue;
+        }
+        double cx = cut(gen) * sx, cy = cut(gen) * sy;
+        // Inward offsets from this corner, the notch adds two points on the incoming and outgoing edges
+        double dx = p[0] == 0 ? cx : -cx, dy = p[1] == 0 ? cy : -cy;
+        if (c % 2 == 0) {
+            points.push_back({ p[0], p[1] + dy });
+            points.push_back({ p[0] + dx, p[1] + dy });
+            points.push_back({ p[0] + dx, p[1] });
+        }
+        else {
+            points.push_back({ p[0] + dx, p[1] });
+            points.push_back({ p[0] + dx, p[1] + dy });
+            points.push_back({ p[0], p[1] + dy });
+        }
+    }
+    return points;
+}
+
+static nlohmann::json generateScene(const SceneSpec& spec)
+{
+    std::mt19937 gen(spec.seed);
+    std::uniform_real_distribution<double> unit(0, 1), jitter(0.6, 1.4);
+    const double sx = 1, sy = 1, sz = spec.floorplan ? 0.2 : 0.3;
+
+    nlohmann::json j;
+    j["floorplan"] = spec.floorplan;
+    j["doors"] = nlohmann::json::array();
+    j["windows"] = nlohmann::json::array();
+    j["boundary"] = { { "origin_pos", { 0, 0, 0 } }, { "size", { sx, sy, sz } },
+        { "points", boundaryPoints(sx, sy, std::clamp(spec.notches, 0, 4), gen) } };
+
+    // Obstacles are small columns standing in the room
+    j["obstacles"] = nlohmann::json::array();
+    for (int i = 0; i < spec.obstacles; ++i) {
+        double l = 0.04 + 0.06 * unit(gen), w = 0.04 + 0.06 * unit(gen);
+        double x = 0.2 + 0.6 * unit(gen), y = 0.2 + 0.6 * unit(gen);
+        j["obstacles"].push_back({ { "pos", { x, y, sz / 2 } }, { "size", { l, w, sz } } });
+    }
+
+    // Objects cover about 40% of the floor, rooms of a floor plan nearly all of it
+    double fill = spec.floorplan ? 0.9 : 0.4;
+    double side = std::sqrt(fill * sx * sy / std::max(1, spec.objects));
+    j["vertices"] = nlohmann::json::array();
+    for (int i = 0; i < spec.objects; ++i) {
+        double l = std::min(0.9 * sx, side * jitter(gen)), w = std::min(0.9 * sy, side * jitter(gen));
+        double h = spec.floorplan ? sz : sz * (0.2 + 0.5 * unit(gen));
+        double tolerance = spec.floorplan ? 0.5 : 0.2;
+        j["vertices"].push_back({ { "label", (spec.floorplan ? "Room" : "Object") + std::to_string(i) }, { "id", i },
+            { "boundary", -1 }, { "corner", -1 }, { "on_floor", true }, { "hanging", false },
+            { "target_pos", nlohmann::json::array() }, { "target_size", { l, w, h } },
+            { "pos_tolerance", nlohmann::json::array() }, { "size_tolerance", { l * tolerance, w * tolerance, 0 } },
+            { "orientation", (int)(gen() % 4) } });
+    }
+
+    // Only LeftOf and FrontOf relations from a higher to a lower id, so that GraphProcessor finds no cycle to remove
+    j["edges"] = nlohmann::json::array();
+    int num_edges = std::lround(spec.density * spec.objects);
+    for (int e = 0; e < num_edges && spec.objects > 1; ++e) {
+        int source = 1 + gen() % (spec.objects - 1);
+        int target = gen() % source;
+        j["edges"].push_back({ { "source", source }, { "target", target }, { "type", gen() % 2 == 0 ? LeftOf : FrontOf }, { "distance", 0 } });
+    }
+    return j;
+}
+
+// Resident memory of the process in MB. The peak is a high-water mark over the whole run, so the cases
+// report the current value and its change instead.
+static double residentMemory()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize / 1048576.0;
+#else
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmRSS:", 0) == 0)
+            return std::stod(line.substr(6)) / 1024;
+#endif
+    return 0;
+}
+
+// Quality of a solution: overlapping object pairs and objects outside the boundary box
+static void checkSolution(const SceneGraph& g, const Boundary& boundary, bool floorplan, int& overlaps, int& outside)
+{
+    const double eps = 1e-4;
+    int dims = floorplan ? 2 : 3;
+    overlaps = outside = 0;
+    std::vector<VertexDescriptor> placed;
+    VertexIterator vi, vi_end;
+    for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+        const VertexProperties& vp = g[*vi];
+        if (vp.pos.size() < 3 || vp.size.size() < 3)
+            continue;
+        placed.push_back(*vi);
+        for (int k = 0; k < dims; ++k) {
+            if (vp.pos[k] - vp.size[k] / 2 < boundary.origin_pos[k] - eps || vp.pos[k] + vp.size[k] / 2 > boundary.origin_pos[k] + boundary.size[k] + eps) {
+                outside++;
+                break;
+            }
+        }
+    }
+    for (size_t a = 0; a < placed.size(); ++a) {
+        for (size_t b = a + 1; b < placed.size(); ++b) {
+            const VertexProperties &va = g[placed[a]], &vb = g[placed[b]];
+            bool overlap = true;
+            for (int k = 0; k < dims && overlap; ++k)
+                overlap = std::fabs(va.pos[k] - vb.pos[k]) < (va.size[k] + vb.size[k]) / 2 - eps;
+            overlaps += overlap;
+        }
+    }
+}
+
+struct BenchResult {
+    std::string name, kind, status;
+    SceneSpec spec;
+    // rss after the case and its change over the case, in MB
+    double seconds = 0, rss = 0, rssDelta = 0;
+    int overlaps = 0, outside = 0;
+    SolveStats stats;
+};
+
+static BenchResult runCase(Solver& solver, const std::string& name, const std::string& kind, const fs::path& input,
+    const fs::path& output, const BenchOptions& options, const SceneSpec& spec)
+{
+    BenchResult result;
+    result.name = name;
+    result.kind = kind;
+    result.spec = spec;
+    double rssBefore = residentMemory();
+    auto start = std::chrono::steady_clock::now();
+    try {
+        solver.readSceneGraph(input.string(), options.wallWidth);
+        solver.outputpath = output.string();
+        solver.solve();
+        result.stats = solver.getstats();
+        if (!solver.getconflictinfo().empty())
+            result.status = "conflict";
+        else if (result.stats.solCount > 0)
+            result.status = "solved";
+        else
+            result.status = "no_solution";
+        checkSolution(solver.getsolution(), solver.getboundary(), solver.floorplan, result.overlaps, result.outside);
+    }
+    catch (GRBException& e) {
+        result.status = "failed (Gurobi error " + std::to_string(e.getErrorCode()) + ")";
+    }
+    catch (const std::exception& e) {
+        result.status = std::string("failed (") + e.what() + ")";
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.rss = residentMemory();
+    result.rssDelta = result.rss - rssBefore;
+    return result;
+}
+
+static void writeCsv(const std::string& path, const std::vector<BenchResult>& results)
+{
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open CSV file for writing: " << path << std::endl;
+        return;
+    }
+    out << "name,kind,floorplan,objects,obstacles,density,notches,seed,status,total_s,parse_s,process_s,build_s,"
+        << "optimize_s,iis_s,variables,binaries,constraints,nonoverlap_pairs,node_count,mip_gap,objective,"
+        << "overlaps,outside,rss_mb,rss_delta_mb\n";
+    for (const BenchResult& r : results) {
+        const SolveStats& s = r.stats;
+        out << r.name << "," << r.kind << "," << r.spec.floorplan << "," << r.spec.objects << "," << r.spec.obstacles << ","
+            << r.spec.density << "," << r.spec.notches << "," << r.spec.seed << ",\"" << r.status << "\"," << r.seconds << ","
+            << s.parseTime << "," << s.processTime << "," << s.buildTime << "," << s.optimizeTime << "," << s.iisTime << ","
+            << s.numVars << "," << s.numBinVars << "," << s.numConstrs << "," << s.nonOverlapPairs << "," << s.nodeCount << ","
+            << s.mipGap << "," << s.objective << "," << r.overlaps << "," << r.outside << "," << r.rss << "," << r.rssDelta << "\n";
+    }
+}
+
+static void writeJson(const std::string& path, const std::vector<BenchResult>& results)
+{
+    nlohmann::json j = nlohmann::json::array();
+    for (const BenchResult& r : results) {
+        j.push_back({ { "name", r.name }, { "kind", r.kind }, { "status", r.status }, { "total_time", r.seconds },
+            { "scene", { { "floorplan", r.spec.floorplan }, { "objects", r.spec.objects }, { "obstacles", r.spec.obstacles },
+                { "density", r.spec.density }, { "notches", r.spec.notches }, { "seed", r.spec.seed } } },
+            { "quality", { { "overlaps", r.overlaps }, { "outside", r.outside } } },
+            { "memory", { { "rss_mb", r.rss }, { "rss_delta_mb", r.rssDelta } } },
+            { "stats", r.stats.toJson() } });
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open JSON file for writing: " << path << std::endl;
+        return;
+    }
+    out << j.dump(4) << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&](const char* name) -> std::string {
+            if (i + 1 >= argc)
+                throw std::runtime_error(std::string("Missing value for ") + name);
+            return argv[++i];
+        };
+        try {
+            if (arg == "-h" || arg == "--help") {
+                printUsage(argv[0]);
+                return 0;
+            }
+            else if (arg == "-n" || arg == "--objects")
+                options.objects = parseList<int>(next("--objects"));
+            else if (arg == "-m" || arg == "--obstacles")
+                options.obstacles = parseList<int>(next("--obstacles"));
+            else if (arg == "-d" || arg == "--density")
+                options.density = parseList<double>(next("--density"));
+            else if (arg == "-k" || arg == "--notches")
+                options.notches = parseList<int>(next("--notches"));
+            else if (arg == "--mode") {
+                std::string mode = next("--mode");
+                if (mode != "3d" && mode != "floorplan" && mode != "both")
+                    throw std::runtime_error("Unknown mode: " + mode);
+                options.solve3d = mode != "floorplan";
+                options.solveFloorplan = mode != "3d";
+            }
+            else if (arg == "-r" || arg == "--repeat")
+                options.repeat = std::stoi(next("--repeat"));
+            else if (arg == "-s" || arg == "--seed")
+                options.seed = std::stoul(next("--seed"));
+            else if (arg == "-t" || arg == "--threads")
+                options.threads = std::stoi(next("--threads"));
+            else if (arg == "-T" || arg == "--time-limit")
+                options.timeLimit = std::stod(next("--time-limit"));
+            else if (arg == "--decompose")
+                options.decompose = true;
+            else if (arg == "-p" || arg == "--portfolio")
+                options.portfolio = std::stoi(next("--portfolio"));
+            else if (arg == "--no-baselines")
+                options.baselines = false;
+            else if (arg == "--csv")
+                options.csvPath = next("--csv");
+            else if (arg == "--json")
+                options.jsonPath = next("--json");
+            else if (arg == "--work-dir")
+                options.workDir = next("--work-dir");
+            else
+                throw std::runtime_error("Unknown option: " + arg);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    fs::path work = options.workDir.empty() ? fs::temp_directory_path() / "AutoHomePlan_bench" : fs::path(options.workDir);
+    fs::create_directories(work);
+
+    Solver solver;
+    solver.verbose = false;
+    solver.saveDebugFiles = false;
+    solver.nameConstraints = false;
+    solver.threads = options.threads;
+    solver.timeLimit = options.timeLimit;
+    solver.decompose = options.decompose;
+    solver.portfolio = options.portfolio;
+
+    std::vector<BenchResult> results;
+    auto report = [&](const BenchResult& r) {
+        std::cout << r.name << ": " << r.status << " in " << r.seconds << " s (build " << r.stats.buildTime << " s, optimize "
+                  << r.stats.optimizeTime << " s, " << r.stats.numBinVars << " binaries, gap " << r.stats.mipGap << ")" << std::endl;
+        results.push_back(r);
+    };
+
+    // Fixed baselines: the shipped sample scenes, solved from their own directory so the inputs stay untouched
+    if (options.baselines) {
+        fs::path samples = fs::path(ASSETS_DIR) / "SceneGraph";
+        for (const char* name : { "test", "test2", "conflict" }) {
+            fs::path input = samples / (std::string(name) + ".json");
+            if (!fs::exists(input)) {
+                std::cerr << "Missing baseline scene: " << input.string() << std::endl;
+                continue;
+            }
+            SceneSpec spec = {};
+            report(runCase(solver, name, "baseline", input, work / (std::string(name) + "_output.json"), options, spec));
+        }
+    }
+
+    // Synthetic sweep over every parameter combination
+    std::vector<bool> modes;
+    if (options.solve3d)
+        modes.push_back(false);
+    if (options.solveFloorplan)
+        modes.push_back(true);
+    for (bool floorplan : modes)
+        for (int objects : options.objects)
+            for (int obstacles : options.obstacles)
+                for (double density : options.density)
+                    for (int notches : options.notches)
+                        for (int r = 0; r < options.repeat; ++r) {
+                            SceneSpec spec = { objects, obstacles, notches, density, floorplan, options.seed + r };
+                            std::string name = spec.name();
+                            fs::path input = work / (name + ".json");
+                            std::ofstream scene(input);
+                            scene << generateScene(spec).dump(4) << std::endl;
+                            scene.close();
+                            report(runCase(solver, name, "synthetic", input, work / (name + "_output.json"), options, spec));
+                        }
+
+    writeCsv(options.csvPath, results);
+    writeJson(options.jsonPath, results);
+    int failed = std::count_if(results.begin(), results.end(), [](const BenchResult& r) { return r.status.rfind("failed", 0) == 0; });
+    std::cout << results.size() << " scenes, " << failed << " failed. Reports: " << options.csvPath << ", " << options.jsonPath << std::endl;
+    return failed > 0 ? 1 : 0;
+}
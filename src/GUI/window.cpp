@@ -44,6 +44,11 @@ Window::Window(const std::string& window_name) : name_(window_name)
 
 Window::~Window()
 {
+    if (solve_job_.valid())
+    {
+        solver_.cancel();
+        solve_job_.wait();
+    }
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -96,8 +101,38 @@ void Window::BuildUI()
     else
         is_context_menu_open_ = false;
     
+    // The solve runs on a worker thread; its results are handed to the scene viewer here, on the render thread
+    bool solving = solve_job_.valid();
+    if (solving && solve_job_.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        try {
+            solve_job_.get();
+        }
+        catch (...) {
+            std::cerr << "Exception during solve" << std::endl;
+        }
+        solving = false;
+        scene_viewer_.reset();
+        if (solver_.floorplan)
+            scene_viewer_.setupRooms(solver_.getsolution(), solver_.getboundaryMaxSize());
+        else
+            scene_viewer_.setupOneRoom(solver_.getsolution(), solver_.getboundary());
+        solver_.getincumbent(incumbent_);
+    }
+    // Draw the newest incumbent published by the running solve
+    else if (solving && solver_.streamIncumbents && solver_.getincumbent(incumbent_))
+    {
+        scene_viewer_.reset();
+        if (solver_.floorplan)
+            scene_viewer_.setupRooms(incumbent_.graph, solver_.getboundaryMaxSize());
+        else
+            scene_viewer_.setupOneRoom(incumbent_.graph, solver_.getboundary());
+    }
+
     if (ImGui::Begin("Setting Solver"))
     {
+        // The solver options must not change under the running solve
+        ImGui::BeginDisabled(solving);
         ImGui::SliderInt("Scaling Factor for process obstacles(10^n)", &solver_.scalingFactor, 1, 10);
 
         double min_value = 0.0;
@@ -109,15 +144,57 @@ void Window::BuildUI()
 
         ImGui::Spacing();
         ImGui::SliderFloat("Wall Width(x percentage of boundary size)", &scene_viewer_.wallWidth, 0.0f, 0.1f);
+        ImGui::Checkbox("Solve unrelated groups separately", &solver_.decompose);
+        ImGui::Checkbox("Add non-overlap constraints lazily", &solver_.lazyNonOverlap);
+        ImGui::Checkbox("Start from the heuristic layout", &solver_.heuristicStart);
+        ImGui::Checkbox("Show incumbents while solving", &solver_.streamIncumbents);
+        // HiGHS solves MILPs only, the box shows checked while it is selected and keeps the Gurobi choice
+        bool linear = solver_.objectiveMode == ObjectiveMode::Linear || solver_.backend != MipBackendType::Gurobi;
+        if (ImGui::Checkbox("Linear objective (MILP)", &linear) && solver_.backend == MipBackendType::Gurobi)
+            solver_.objectiveMode = linear ? ObjectiveMode::Linear : ObjectiveMode::Quadratic;
+        // Applied when the next scene graph is imported
+        const char* policies[] = { "Report conflicts", "Drop constraint", "Relax constraint", "Drop object", "Cheapest plan" };
+        int policy = static_cast<int>(solver_.conflictPolicy);
+        if (ImGui::Combo("Conflict policy", &policy, policies, IM_ARRAYSIZE(policies)))
+            solver_.conflictPolicy = static_cast<ConflictPolicy>(policy);
+        const char* backends[] = { "Gurobi", "HiGHS" };
+        int backend = static_cast<int>(solver_.backend);
+        if (ImGui::Combo("MIP solver", &backend, backends, IM_ARRAYSIZE(backends)))
+            solver_.backend = static_cast<MipBackendType>(backend);
 
         if (ImGui::Button("Solve"))
         {
-            scene_viewer_.reset();
-            solver_.solve();
-            if (solver_.floorplan)
-                scene_viewer_.setupRooms(solver_.getsolution(), solver_.getboundaryMaxSize());
+            solve_start_ = glfwGetTime();
+            solve_job_ = std::async(std::launch::async, [this] { solver_.solve(); });
+        }
+        ImGui::SameLine();
+        // Reuses the built model and the last solution, e.g. after changing the weights above
+        if (ImGui::Button("Re-solve"))
+        {
+            solve_start_ = glfwGetTime();
+            solve_job_ = std::async(std::launch::async, [this] { solver_.resolve(); });
+        }
+        ImGui::SameLine();
+        // Heuristic layout only, without the MIP
+        if (ImGui::Button("Preview"))
+        {
+            solve_start_ = glfwGetTime();
+            solve_job_ = std::async(std::launch::async, [this] { solver_.preview(); });
+        }
+        ImGui::EndDisabled();
+
+        if (solving)
+        {
+            SolveProgress progress = solver_.getprogress();
+            double elapsed = glfwGetTime() - solve_start_;
+            float fraction = solver_.timeLimit > 0 ? (float)std::min(1.0, elapsed / solver_.timeLimit) : 0.0f;
+            ImGui::ProgressBar(fraction, ImVec2(-1, 0), std::format("{:.1f} s", elapsed).c_str());
+            if (progress.solutions > 0)
+                ImGui::Text("Solutions: %d  Objective: %.4f  Bound: %.4f  Nodes: %.0f", progress.solutions, progress.objective, progress.bound, progress.nodes);
             else
-                scene_viewer_.setupOneRoom(solver_.getsolution(), solver_.getboundary());
+                ImGui::Text("Searching for a first solution...");
+            if (ImGui::Button("Cancel"))
+                solver_.cancel();
         }
     }
     ImGui::End();
@@ -140,7 +217,7 @@ void Window::BuildUI()
             {
                 flag_open_file_dialog_ = true;
             }
-            if (ImGui::MenuItem("Import SceneGraph"))
+            if (ImGui::MenuItem("Import SceneGraph", nullptr, false, !solving))
             {
                 flag_open_graph_dialog_ = true;
             }
@@ -172,6 +249,18 @@ void Window::BuildUI()
             if (ImGuiFileDialog::Instance()->IsOk())
             {
                 std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
+                // The dialog may have been opened before a solve started: the worker must be done with solver_,
+                // and its result is dropped instead of being shown over the new scene graph
+                if (solve_job_.valid())
+                {
+                    solver_.cancel();
+                    try {
+                        solve_job_.get();
+                    }
+                    catch (...) {
+                        std::cerr << "Exception during solve" << std::endl;
+                    }
+                }
                 scene_viewer_.reset();
                 solver_.reset();
                 solver_.readSceneGraph(filePathName, scene_viewer_.wallWidth);
@@ -0,0 +1,130 @@
+#include "Components/Broadphase.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+AABB BoxRange::bounds() const
+{
+    AABB box;
+    for (int k = 0; k < 3; ++k) {
+        box.lo[k] = cmin[k] - smax[k] / 2;
+        box.hi[k] = cmax[k] + smax[k] / 2;
+    }
+    return box;
+}
+
+bool BoxRange::canBeOnSide(const BoxRange& other, int side) const
+{
+    return maxGap(other, side) >= 0;
+}
+
+double BoxRange::maxGap(const BoxRange& other, int side) const
+{
+    // Sides come in pairs per axis: even = greater coordinate (right, front, above), odd = smaller one
+    int k = side / 2;
+    if (side % 2 == 0)
+        return (cmax[k] - smin[k] / 2) - (other.cmin[k] + other.smin[k] / 2);
+    return (other.cmax[k] - other.smin[k] / 2) - (cmin[k] + smin[k] / 2);
+}
+
+double BoxRange::maxOverlap(const BoxRange& other, int side) const
+{
+    int k = side / 2;
+    if (side % 2 == 0)
+        return (other.cmax[k] + other.smax[k] / 2) - (cmin[k] - smax[k] / 2);
+    return (cmax[k] + smax[k] / 2) - (other.cmin[k] - other.smax[k] / 2);
+}
+
+bool BoxRange::contains(const BoxRange& inner) const
+{
+    for (int k = 0; k < 3; ++k)
+        if (inner.cmin[k] < cmin[k] || inner.cmax[k] > cmax[k] || inner.smin[k] < smin[k] || inner.smax[k] > smax[k])
+            return false;
+    return true;
+}
+
+static bool overlaps(const AABB& a, const AABB& b, int dims)
+{
+    for (int k = 0; k < dims; ++k)
+        if (a.hi[k] <= b.lo[k] || b.hi[k] <= a.lo[k])
+            return false;
+    return true;
+}
+
+void sweepAndPrune(const std::vector<AABB>& boxes, int dims, const std::function<void(int, int)>& report)
+{
+    std::vector<int> order(boxes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return boxes[a].lo[0] < boxes[b].lo[0]; });
+
+    // Boxes whose x interval may still overlap the ones further along the sweep
+    std::vector<int> active;
+    for (int i : order) {
+        active.erase(std::remove_if(active.begin(), active.end(),
+            [&](int j) { return boxes[j].hi[0] <= boxes[i].lo[0]; }), active.end());
+        for (int j : active)
+            if (overlaps(boxes[i], boxes[j], dims))
+                report(std::min(i, j), std::max(i, j));
+        active.push_back(i);
+    }
+}
+
+BoxGrid::BoxGrid(const std::vector<AABB>& boxes, int dims) : boxes(boxes), dims(dims), cellSize(1), cols(1), rows(1)
+{
+    origin[0] = origin[1] = 0;
+    if (boxes.empty())
+        return;
+    double hi[2] = { boxes[0].hi[0], boxes[0].hi[1] }, mean = 0;
+    origin[0] = boxes[0].lo[0];
+    origin[1] = boxes[0].lo[1];
+    for (const AABB& box : boxes) {
+        for (int k = 0; k < 2; ++k) {
+            origin[k] = std::min(origin[k], box.lo[k]);
+            hi[k] = std::max(hi[k], box.hi[k]);
+        }
+        mean += std::max(box.hi[0] - box.lo[0], box.hi[1] - box.lo[1]) / boxes.size();
+    }
+    // About one box per cell, but cells no smaller than a typical box
+    double extent = std::max(hi[0] - origin[0], hi[1] - origin[1]);
+    cellSize = std::max(mean, extent / std::ceil(std::sqrt((double)boxes.size())));
+    if (cellSize <= 0)
+        cellSize = 1;
+    cols = std::max(1, (int)std::ceil((hi[0] - origin[0]) / cellSize));
+    rows = std::max(1, (int)std::ceil((hi[1] - origin[1]) / cellSize));
+    cells.assign(cols * rows, {});
+    for (int i = 0; i < (int)boxes.size(); ++i) {
+        int x0, x1, y0, y1;
+        cellRange(boxes[i], x0, x1, y0, y1);
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                cells[y * cols + x].push_back(i);
+    }
+}
+
+void BoxGrid::cellRange(const AABB& box, int& x0, int& x1, int& y0, int& y1) const
+{
+    auto cell = [&](double v, int k, int count) {
+        return std::clamp((int)std::floor((v - origin[k]) / cellSize), 0, count - 1);
+    };
+    x0 = cell(box.lo[0], 0, cols);
+    x1 = cell(box.hi[0], 0, cols);
+    y0 = cell(box.lo[1], 1, rows);
+    y1 = cell(box.hi[1], 1, rows);
+}
+
+void BoxGrid::query(const AABB& box, std::vector<int>& result) const
+{
+    result.clear();
+    if (cells.empty())
+        return;
+    int x0, x1, y0, y1;
+    cellRange(box, x0, x1, y0, y1);
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x)
+            for (int i : cells[y * cols + x])
+                if (overlaps(box, boxes[i], dims))
+                    result.push_back(i);
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+}
@@ -0,0 +1,159 @@
+#include "Components/FeasibilityCheck.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// face[to] - face[from] <= weight, from row (-1 for the implied lo <= hi)
+struct DifferenceEdge {
+    int from, to;
+    double weight;
+    int row;
+};
+
+// sum coeffs[k] * face[nodes[k]] + constant, a row rewritten on the box faces
+struct FaceRow {
+    static const int capacity = 2 * ModelBuilder::Expr::capacity;
+    int size = 0;
+    int nodes[capacity];
+    double coeffs[capacity];
+    double constant = 0;
+
+    void add(int node, double coeff)
+    {
+        for (int k = 0; k < size; ++k) {
+            if (nodes[k] == node) {
+                coeffs[k] += coeff;
+                return;
+            }
+        }
+        nodes[size] = node;
+        coeffs[size++] = coeff;
+    }
+};
+
+bool same(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b));
+}
+
+// Adds the edges of sign * row <= 0, false when the row has no difference form
+bool addEdges(const FaceRow& face, double sign, int origin, int row, std::vector<DifferenceEdge>& edges)
+{
+    int nodes[2];
+    double coeffs[2];
+    int size = 0;
+    for (int k = 0; k < face.size; ++k) {
+        if (std::abs(face.coeffs[k]) < 1e-12)
+            continue;
+        if (size == 2)
+            return false;
+        nodes[size] = face.nodes[k];
+        coeffs[size++] = sign * face.coeffs[k];
+    }
+    double c = sign * face.constant;
+    if (size == 0) {
+        // Constant row: always violated or always satisfied
+        if (c > 1e-6)
+            edges.push_back({ origin, origin, -c, row });
+        return true;
+    }
+    if (size == 1) {
+        double a = coeffs[0];
+        if (a > 0)
+            edges.push_back({ origin, nodes[0], -c / a, row });
+        else
+            edges.push_back({ nodes[0], origin, c / a, row });
+        return true;
+    }
+    if (same(coeffs[0], -coeffs[1])) {
+        int u = coeffs[0] > 0 ? nodes[0] : nodes[1], w = coeffs[0] > 0 ? nodes[1] : nodes[0];
+        edges.push_back({ w, u, -c / std::abs(coeffs[0]), row });
+        return true;
+    }
+    // a * (lo + hi) + c <= 0 on one box axis: relaxed to lo <= -c / 2a for a > 0 and hi >= -c / 2a for a < 0
+    if (same(coeffs[0], coeffs[1]) && nodes[0] / 2 == nodes[1] / 2) {
+        double a = coeffs[0];
+        int lo = std::min(nodes[0], nodes[1]), hi = std::max(nodes[0], nodes[1]);
+        if (a > 0)
+            edges.push_back({ origin, lo, -c / (2 * a), row });
+        else
+            edges.push_back({ hi, origin, c / (2 * a), row });
+        return true;
+    }
+    return false;
+}
+
+}
+
+std::vector<int> infeasibleRows(int numObjects, const std::vector<ModelBuilder::Constr>& rows)
+{
+    // Face nodes 6 * id + 2 * axis (+1 for hi), all axes share the origin node
+    int origin = 6 * numObjects, num_nodes = origin + 1;
+    std::vector<DifferenceEdge> edges;
+    edges.reserve(2 * rows.size() + 3 * numObjects);
+    for (int node = 0; node < origin; node += 2)
+        edges.push_back({ node + 1, node, 0, -1 });
+    for (int r = 0; r < (int)rows.size(); ++r) {
+        const ModelBuilder::Expr& e = rows[r].expr;
+        FaceRow face;
+        face.constant = e.constant;
+        bool box_row = true;
+        for (int k = 0; k < e.size && box_row; ++k) {
+            int id = e.vars[k] / 6, part = e.vars[k] % 6, axis = part % 3;
+            box_row = id >= 0 && id < numObjects;
+            // a * x + b * l = (a / 2 - b) * lo + (a / 2 + b) * hi
+            double a = part < 3 ? e.coeffs[k] : 0, b = part < 3 ? 0 : e.coeffs[k];
+            face.add(6 * id + 2 * axis, a / 2 - b);
+            face.add(6 * id + 2 * axis + 1, a / 2 + b);
+        }
+        if (!box_row)
+            continue;
+        char sense = rows[r].sense;
+        if (sense != GRB_GREATER_EQUAL && !addEdges(face, 1, origin, r, edges))
+            continue;
+        if (sense != GRB_LESS_EQUAL)
+            addEdges(face, -1, origin, r, edges);
+    }
+
+    // Bellman-Ford from a virtual source linked to every node; a relaxation in pass num_nodes means a negative cycle
+    std::vector<double> dist(num_nodes, 0);
+    std::vector<int> pred(num_nodes, -1);
+    int last = -1;
+    for (int pass = 0; pass < num_nodes; ++pass) {
+        last = -1;
+        for (int k = 0; k < (int)edges.size(); ++k) {
+            const DifferenceEdge& edge = edges[k];
+            if (dist[edge.from] + edge.weight < dist[edge.to] - 1e-9) {
+                dist[edge.to] = dist[edge.from] + edge.weight;
+                pred[edge.to] = k;
+                last = edge.to;
+            }
+        }
+        if (last < 0)
+            return {};
+    }
+    // Walking back num_nodes predecessors ends on the cycle
+    int v = last;
+    for (int k = 0; k < num_nodes && v >= 0; ++k)
+        v = pred[v] >= 0 ? edges[pred[v]].from : -1;
+    if (v < 0)
+        return {};
+    std::vector<int> result;
+    double weight = 0;
+    int u = v, steps = 0;
+    do {
+        const DifferenceEdge& edge = edges[pred[u]];
+        weight += edge.weight;
+        if (edge.row >= 0)
+            result.push_back(edge.row);
+        u = edge.from;
+    } while (u != v && ++steps < num_nodes);
+    // Cycles within the solver tolerances do not prove anything
+    if (weight > -1e-6)
+        return {};
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
@@ -0,0 +1,137 @@
+#include "Components/FeedbackArcSet.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+// Vertex order with the least total weight of backward arcs, by dynamic programming over the set of placed vertices
+static std::vector<int> exactOrder(int n, const std::vector<Arc>& arcs)
+{
+    // back[v * n + u]: weight lost when v is placed after u
+    std::vector<double> back(n * n, 0);
+    for (const Arc& a : arcs)
+        if (a.from != a.to)
+            back[a.from * n + a.to] += a.weight;
+    int full = 1 << n;
+    std::vector<double> best(full, std::numeric_limits<double>::infinity());
+    std::vector<int> last(full, -1);
+    best[0] = 0;
+    for (int placed = 0; placed < full; ++placed) {
+        for (int v = 0; v < n; ++v) {
+            if (placed >> v & 1)
+                continue;
+            double cost = best[placed];
+            for (int u = 0; u < n; ++u)
+                if (placed >> u & 1)
+                    cost += back[v * n + u];
+            int next = placed | 1 << v;
+            if (cost < best[next]) {
+                best[next] = cost;
+                last[next] = v;
+            }
+        }
+    }
+    std::vector<int> order(n);
+    for (int placed = full - 1, k = n - 1; k >= 0; --k) {
+        order[k] = last[placed];
+        placed &= ~(1 << last[placed]);
+    }
+    return order;
+}
+
+// Eades-Lin-Smyth: sinks go to the back, sources to the front, otherwise the vertex with the largest
+// outgoing minus incoming weight goes to the front
+static std::vector<int> eadesLinSmythOrder(int n, const std::vector<Arc>& arcs)
+{
+    std::vector<std::vector<int>> out(n), in(n);
+    std::vector<int> outDeg(n, 0), inDeg(n, 0);
+    std::vector<double> outW(n, 0), inW(n, 0);
+    for (int i = 0; i < (int)arcs.size(); ++i) {
+        const Arc& a = arcs[i];
+        if (a.from == a.to)
+            continue;
+        out[a.from].push_back(i);
+        in[a.to].push_back(i);
+        outDeg[a.from]++;
+        inDeg[a.to]++;
+        outW[a.from] += a.weight;
+        inW[a.to] += a.weight;
+    }
+    // Ordered by inW - outW, so the first entry has the largest outW - inW
+    std::set<std::pair<double, int>> byDelta;
+    std::vector<int> sinks, sources;
+    for (int v = 0; v < n; ++v) {
+        byDelta.insert({ inW[v] - outW[v], v });
+        if (outDeg[v] == 0)
+            sinks.push_back(v);
+        else if (inDeg[v] == 0)
+            sources.push_back(v);
+    }
+
+    std::vector<bool> removed(n, false);
+    auto remove = [&](int v) {
+        removed[v] = true;
+        byDelta.erase({ inW[v] - outW[v], v });
+        for (int i : out[v]) {
+            int u = arcs[i].to;
+            if (removed[u])
+                continue;
+            byDelta.erase({ inW[u] - outW[u], u });
+            inW[u] -= arcs[i].weight;
+            byDelta.insert({ inW[u] - outW[u], u });
+            if (--inDeg[u] == 0)
+                sources.push_back(u);
+        }
+        for (int i : in[v]) {
+            int u = arcs[i].from;
+            if (removed[u])
+                continue;
+            byDelta.erase({ inW[u] - outW[u], u });
+            outW[u] -= arcs[i].weight;
+            byDelta.insert({ inW[u] - outW[u], u });
+            if (--outDeg[u] == 0)
+                sinks.push_back(u);
+        }
+    };
+
+    std::vector<int> front, back;
+    while (!byDelta.empty()) {
+        int v;
+        if (!sinks.empty()) {
+            v = sinks.back();
+            sinks.pop_back();
+            if (removed[v])
+                continue;
+            back.push_back(v);
+        }
+        else if (!sources.empty()) {
+            v = sources.back();
+            sources.pop_back();
+            if (removed[v])
+                continue;
+            front.push_back(v);
+        }
+        else {
+            v = byDelta.begin()->second;
+            front.push_back(v);
+        }
+        remove(v);
+    }
+    front.insert(front.end(), back.rbegin(), back.rend());
+    return front;
+}
+
+std::vector<int> feedbackArcSet(int n, const std::vector<Arc>& arcs, int exactLimit)
+{
+    // The subset table has 2^n entries
+    exactLimit = std::min(exactLimit, 20);
+    std::vector<int> order = n <= exactLimit ? exactOrder(n, arcs) : eadesLinSmythOrder(n, arcs);
+    std::vector<int> position(n);
+    for (int k = 0; k < n; ++k)
+        position[order[k]] = k;
+    std::vector<int> result;
+    for (int i = 0; i < (int)arcs.size(); ++i)
+        if (position[arcs[i].from] >= position[arcs[i].to])
+            result.push_back(i);
+    return result;
+}
@@ -1,4 +1,5 @@
 #include "Components/GraphProcessor.h"
+#include <algorithm>
 #include <iostream>
 
 GraphProcessor::GraphProcessor() {
@@ -52,7 +53,99 @@ bool GraphProcessor::checkInside(std::vector<double> r, std::vector<double> R)
 	return true;
 }
 
-void GraphProcessor::removeCycles(SceneGraph& g, EdgeType edge_type) {
+int GraphProcessor::choosePlan(const std::string& conflict, const std::vector<ConflictPlan>& plans)
+{
+    if (policy == ConflictPolicy::Report) {
+        conflict_info = conflict + ", please select a plan: \n";
+        plan_info = {};
+        for (size_t i = 0; i < plans.size(); ++i)
+            plan_info.push_back("Plan " + std::to_string(i) + ": " + plans[i].description + "\n");
+        return -1;
+    }
+    // Without a plan of the preferred kind the first one is applied, as the interactive prompt did on invalid input
+    int chosen = 0;
+    for (size_t i = 0; i < plans.size(); ++i) {
+        if (policy == ConflictPolicy::CostWeighted) {
+            if (plans[i].cost < plans[chosen].cost)
+                chosen = i;
+        }
+        else if (plans[i].kind == policy) {
+            chosen = i;
+            break;
+        }
+    }
+    applied_plans.push_back(conflict + ": " + plans[chosen].description + "\n");
+    plan_info.push_back(applied_plans.back());
+    return chosen;
+}
+
+void GraphProcessor::resolveCycles(SceneGraph& g, EdgeType edge_type, std::vector<VertexDescriptor>& verticestoremove)
+{
+    // Each pass settles every strongly connected component; removing an object may leave cycles for another pass
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        EdgeTypeFilter edge_filter(g, edge_type);
+        boost::filtered_graph<SceneGraph, EdgeTypeFilter> filtered_g(g, edge_filter);
+        std::vector<int> component(num_vertices(filtered_g));
+        int num = boost::strong_components(filtered_g, &component[0]);
+
+        std::vector<std::vector<EdgeDescriptor>> cycles_edges(num);
+        for (const auto &e : boost::make_iterator_range(edges(filtered_g))) {
+            if (component[source(e, filtered_g)] == component[target(e, filtered_g)])
+                cycles_edges[component[source(e, filtered_g)]].push_back(e);
+        }
+
+        for (const auto &cycle_edges : cycles_edges) {
+            if (cycle_edges.empty())
+                continue;
+            // Minimum-weight set of edges that makes the component acyclic, and the object carrying most of its weight
+            std::map<VertexDescriptor, int> local;
+            std::map<VertexDescriptor, double> load;
+            std::vector<Arc> arcs;
+            for (const auto &e : cycle_edges) {
+                VertexDescriptor s = source(e, g), t = target(e, g);
+                if (!local.count(s))
+                    local[s] = local.size();
+                if (!local.count(t))
+                    local[t] = local.size();
+                arcs.push_back({ local[s], local[t], g[e].weight });
+                load[s] += g[e].weight;
+                load[t] += g[e].weight;
+            }
+            std::vector<int> arc_set = feedbackArcSet(local.size(), arcs);
+            double weight = 0;
+            std::string names;
+            for (int i : arc_set) {
+                weight += arcs[i].weight;
+                names += (names.empty() ? "" : ", ") + g[source(cycle_edges[i], g)].label + " " + edgenames[edge_type] + " " + g[target(cycle_edges[i], g)].label;
+            }
+            VertexDescriptor hub = std::max_element(load.begin(), load.end(),
+                [](const auto& a, const auto& b) { return a.second < b.second; })->first;
+
+            std::vector<ConflictPlan> plans = {
+                { "Remove edge " + names, ConflictPolicy::DropConstraint, weight * costs.edge },
+                { "Remove object: " + g[hub].label, ConflictPolicy::DropObject, costs.object } };
+            int plan = choosePlan("Cycle found in " + edgenames[edge_type] + " constraints", plans);
+            if (plan == 0) {
+                for (int i : arc_set)
+                    boost::remove_edge(cycle_edges[i], g);
+            }
+            else {
+                boost::clear_vertex(hub, g);
+                if (std::find(verticestoremove.begin(), verticestoremove.end(), hub) == verticestoremove.end())
+                    verticestoremove.push_back(hub);
+                changed = true;
+            }
+        }
+    }
+}
+
+void GraphProcessor::removeCycles(SceneGraph& g, EdgeType edge_type, std::vector<VertexDescriptor>& verticestoremove) {
+    if (policy != ConflictPolicy::Report) {
+        resolveCycles(g, edge_type, verticestoremove);
+        return;
+    }
     EdgeTypeFilter edge_filter(g, edge_type);
     boost::filtered_graph<SceneGraph, EdgeTypeFilter> filtered_g(g, edge_filter);
 
@@ -166,22 +259,13 @@ void GraphProcessor::checkPositionConstraint(SceneGraph& g, const Boundary& boun
                 }
             }
             if (pos_boundary_conflict || pos_inside_conflict || pos_obstacle_conflict) {
-                conflict_info = "Conflict found between position/size constraints and inside/obstacle/boundary constraints of Object " + g[*vi].label + ", please select a plan: \n";
-                plan_info = {};
-                plan_info.push_back("Plan 0: Remove position and position tolerance constraints\n");
-                plan_info.push_back("Plan 1: Remove position tolerance constraints only\n");
-                plan_info.push_back("Plan 2: Remove object: " + g[*vi].label + "\n");
-                //std::cout << "Conflict found between position/size constraints and inside/obstacle/boundary constraints of Object " << g[*vi].label << ", please select a plan: " << std::endl;
-                //std::cout << "Plan 0: Remove position and position tolerance constraints" << std::endl;
-                //std::cout << "Plan 1: Remove position tolerance constraints only" << std::endl;
-                //std::cout << "Plan 2: Remove object: " << g[*vi].label << std::endl;
-                if (pos_boundary_conflict && !pos_inside_conflict && !pos_obstacle_conflict) {
-                    plan_info.push_back("Plan 3: Remove boundary constraints\n");
-                    //std::cout << "Plan 3: Remove boundary constraints" << std::endl;
-                }
-                /*
-                int plan;
-                std::cin >> plan;
+                std::vector<ConflictPlan> plans = {
+                    { "Remove position and position tolerance constraints", ConflictPolicy::DropConstraint, costs.position },
+                    { "Remove position tolerance constraints only", ConflictPolicy::Relax, costs.tolerance },
+                    { "Remove object: " + g[*vi].label, ConflictPolicy::DropObject, costs.object } };
+                if (pos_boundary_conflict && !pos_inside_conflict && !pos_obstacle_conflict)
+                    plans.push_back({ "Remove boundary constraints", ConflictPolicy::DropConstraint, costs.boundary });
+                int plan = choosePlan("Conflict found between position/size constraints and inside/obstacle/boundary constraints of Object " + g[*vi].label, plans);
                 if (plan == 0) {
                     g[*vi].target_pos = {};
                     g[*vi].pos_tolerance = {};
@@ -193,15 +277,9 @@ void GraphProcessor::checkPositionConstraint(SceneGraph& g, const Boundary& boun
                     if (std::find(verticestoremove.begin(), verticestoremove.end(), *vi) == verticestoremove.end())
                         verticestoremove.push_back(*vi);
                 }
-                else if (plan == 3 && pos_boundary_conflict && !pos_inside_conflict && !pos_obstacle_conflict) {
+                else if (plan == 3) {
                     g[*vi].boundary = -1;
                 }
-                else {
-                    std::cout << "Invalid plan, choose the first plan." << std::endl;
-                    g[*vi].target_pos = {};
-                    g[*vi].pos_tolerance = {};
-                }
-                */
             }
 		}
 	}
@@ -210,6 +288,7 @@ void GraphProcessor::checkPositionConstraint(SceneGraph& g, const Boundary& boun
 SceneGraph GraphProcessor::process(const SceneGraph& inputGraph, const Boundary& boundary, std::vector<Obstacles> obstacles)
 {
     SceneGraph outputGraph = inputGraph;
+    applied_plans.clear();
     // Find and work with rings in each type of edge
     std::vector<std::pair<VertexDescriptor, VertexDescriptor>> edges_to_reverse, edges_to_remove;
 	std::vector<EdgeProperties> new_edge_properties, removed_edge_properties;
@@ -243,27 +322,22 @@ SceneGraph GraphProcessor::process(const SceneGraph& inputGraph, const Boundary&
         //boost::remove_edge(edges_to_reverse[i].first, edges_to_reverse[i].second, outputGraph);
         boost::add_edge(edges_to_reverse[i].second, edges_to_reverse[i].first, new_edge_properties[i], outputGraph);
     }
+    std::vector<VertexDescriptor> vertices_to_remove;
     for (EdgeType edgetype : {LeftOf, FrontOf, Above}) {
-        removeCycles(outputGraph, edgetype);
+        removeCycles(outputGraph, edgetype, vertices_to_remove);
     }
     // Find the contradiction between boundary constraints and position/orientation constraints
     VertexIterator vi, vi_end;
-    std::vector<VertexDescriptor> vertices_to_remove;
     for (boost::tie(vi, vi_end) = boost::vertices(outputGraph); vi != vi_end; ++vi) {
+        if (std::find(vertices_to_remove.begin(), vertices_to_remove.end(), *vi) != vertices_to_remove.end())
+            continue;
         Orientation o_vi = outputGraph[*vi].orientation;
         if (outputGraph[*vi].boundary >= 0 && boundary.Orientations[outputGraph[*vi].boundary] == o_vi) {
-            conflict_info = "Conflict found: Object " + outputGraph[*vi].label + " face the wall, please select a plan: \n";
-            plan_info = {};
-            plan_info.push_back("Plan 0: Adjust orientation\n");
-            plan_info.push_back("Plan 1: Remove boundary constraint\n");
-            plan_info.push_back("Plan 2: Remove object: " + outputGraph[*vi].label + "\n");
-            /*
-            std::cout << "Conflict found: Object " << outputGraph[*vi].label << " face the wall, please select a plan: " << std::endl;
-            std::cout << "Plan 0: Adjust orientation" << std::endl;
-            std::cout << "Plan 1: Remove boundary constraint" << std::endl;
-            std::cout << "Plan 2: Remove object: " << outputGraph[*vi].label << std::endl;
-            int plan;
-            std::cin >> plan;
+            std::vector<ConflictPlan> plans = {
+                { "Adjust orientation", ConflictPolicy::Relax, costs.orientation },
+                { "Remove boundary constraint", ConflictPolicy::DropConstraint, costs.boundary },
+                { "Remove object: " + outputGraph[*vi].label, ConflictPolicy::DropObject, costs.object } };
+            int plan = choosePlan("Conflict found: Object " + outputGraph[*vi].label + " face the wall", plans);
             if (plan == 0) {
                 outputGraph[*vi].orientation = oppositeOrientation(o_vi);
             }
@@ -271,14 +345,9 @@ SceneGraph GraphProcessor::process(const SceneGraph& inputGraph, const Boundary&
                 outputGraph[*vi].boundary = -1;
             }
             else if (plan == 2) {
-                if (std::find(vertices_to_remove.begin(), vertices_to_remove.end(), *vi) == vertices_to_remove.end())
-                    vertices_to_remove.push_back(*vi);
+                vertices_to_remove.push_back(*vi);
+                continue;
             }
-            else {
-                std::cout << "Invalid plan, choose the first plan." << std::endl;
-                outputGraph[*vi].orientation = oppositeOrientation(o_vi);
-            }
-            */
         }
         // check for contradictions between position/size constraints and on-floor constarints
         if (!outputGraph[*vi].target_pos.empty() && !outputGraph[*vi].pos_tolerance.empty() &&
@@ -286,18 +355,11 @@ SceneGraph GraphProcessor::process(const SceneGraph& inputGraph, const Boundary&
             outputGraph[*vi].target_pos[2] - outputGraph[*vi].pos_tolerance[2] >
             outputGraph[*vi].target_size[2] / 2 + outputGraph[*vi].size_tolerance[2] / 2 && outputGraph[*vi].on_floor)
             {
-                conflict_info = "Contradiction found between position/size constraints and on-floor constraints of Object "+ outputGraph[*vi].label + ", please select a plan: \n";
-                plan_info = {};
-                plan_info.push_back("Plan 0: Remove on-floor constraint\n");
-                plan_info.push_back("Plan 1: Adjust position/size constraints\n");
-                plan_info.push_back("Plan 2: Remove object: " + outputGraph[*vi].label + "\n");
-                /*
-                std::cout << "Contradiction found between position/size constraints and on-floor constraints of Object "<< outputGraph[*vi].label << ", please select a plan: " << std::endl;
-                std::cout << "Plan 0: Remove on-floor constraint" << std::endl;
-                std::cout << "Plan 1: Adjust position/size constraints" << std::endl;
-                std::cout << "Plan 2: Remove object: " << outputGraph[*vi].label << std::endl;
-                int plan;
-                std::cin >> plan;
+                std::vector<ConflictPlan> plans = {
+                    { "Remove on-floor constraint", ConflictPolicy::DropConstraint, costs.onFloor },
+                    { "Adjust position/size constraints", ConflictPolicy::Relax, costs.tolerance },
+                    { "Remove object: " + outputGraph[*vi].label, ConflictPolicy::DropObject, costs.object } };
+                int plan = choosePlan("Contradiction found between position/size constraints and on-floor constraints of Object " + outputGraph[*vi].label, plans);
                 if (plan == 0) {
                     outputGraph[*vi].on_floor = false;
                 }
@@ -305,17 +367,13 @@ SceneGraph GraphProcessor::process(const SceneGraph& inputGraph, const Boundary&
                     outputGraph[*vi].target_pos[2] = outputGraph[*vi].target_size[2] / 2;
                 }
                 else if (plan == 2) {
-                    if (std::find(vertices_to_remove.begin(), vertices_to_remove.end(), *vi) == vertices_to_remove.end())
-                        vertices_to_remove.push_back(*vi);
-                }
-                else {
-                    std::cout << "Invalid plan, choose the first plan." << std::endl;
-                    outputGraph[*vi].on_floor = false;
+                    vertices_to_remove.push_back(*vi);
                 }
-                */
             }
     }
     //checkPositionConstraint(outputGraph, boundary, obstacles, vertices_to_remove);
+    // Descriptors of a vecS graph shift on removal, so remove from the highest one down
+    std::sort(vertices_to_remove.rbegin(), vertices_to_remove.rend());
     for (auto i = 0; i < vertices_to_remove.size(); ++i) {
         boost::clear_vertex(vertices_to_remove[i], outputGraph);
         boost::remove_vertex(vertices_to_remove[i], outputGraph);
@@ -615,5 +673,5 @@ SceneGraph GraphProcessor::splitGraph2(const SceneGraph& g, const Boundary& boun
 void GraphProcessor::reset()
 {
     conflict_info = "";
-    plan_info = {};
+    plan_info = applied_plans;
 }
\ No newline at end of file
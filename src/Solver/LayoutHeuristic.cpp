@@ -0,0 +1,386 @@
+#include "Components/LayoutHeuristic.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+
+class Annealer {
+public:
+    Annealer(const LayoutProblem& problem, const HeuristicSettings& settings);
+    HeuristicResult run();
+
+private:
+    double value(const ModelBuilder::Expr& e) const;
+    double rowViolation(int r) const;
+    double overlap(const double* a, const double* b) const;
+    double cornerViolation(int i) const;
+    double obstacleViolation(int i) const;
+    // Whether a flat coordinate is used, z and h are not in floor plans
+    bool active(int c) const { return c % 3 < dims; }
+    bool ready(const std::vector<int>& ids) const;
+    // Parts of the violation and objective that depend on object i, restricted to placed objects
+    double violationOf(int i) const;
+    double objectiveOf(int i) const;
+    double areaViolation(double area) const { return p.totalArea < 0 ? 0 : std::abs(area - p.totalArea); }
+    double boxArea(int i) const { return v[6 * i + 3] * v[6 * i + 4]; }
+    void clamp(int i);
+    // Moves one coordinate of i so that the violated row r holds
+    void repair(int i, int r);
+    // Pushes i out of the first placed object it overlaps, along the axis of least penetration
+    void separate(int i);
+    void place(int i);
+    void recompute();
+
+    const LayoutProblem& p;
+    HeuristicSettings settings;
+    int n, dims;
+    std::mt19937 rng;
+    std::vector<double> v;
+    std::vector<char> placed;
+    std::vector<std::vector<int>> rowObjects, errorObjects, rowsOf, errorsOf;
+    std::vector<double> areaWeightOf;
+    std::vector<std::array<double, 6>> obstacleBoxes;
+    double penalty = 10, sumArea = 0, violation = 0, objective = 0;
+};
+
+Annealer::Annealer(const LayoutProblem& problem, const HeuristicSettings& settings)
+    : p(problem), settings(settings), n(problem.ranges.size()), dims(problem.dims), rng(settings.seed),
+      v(6 * n, 0), placed(n, 0), rowsOf(n), errorsOf(n), areaWeightOf(n, 0)
+{
+    auto objectsOf = [&](const ModelBuilder::Expr& e) {
+        std::vector<int> ids;
+        for (int k = 0; k < e.size; ++k)
+            if (e.vars[k] >= 0 && std::find(ids.begin(), ids.end(), e.vars[k] / 6) == ids.end())
+                ids.push_back(e.vars[k] / 6);
+        return ids;
+    };
+    for (int r = 0; r < (int)p.rows.size(); ++r) {
+        rowObjects.push_back(objectsOf(p.rows[r].expr));
+        for (int id : rowObjects.back())
+            rowsOf[id].push_back(r);
+    }
+    for (int e = 0; e < (int)p.errors.size(); ++e) {
+        errorObjects.push_back(objectsOf(p.errors[e]));
+        for (int id : errorObjects.back())
+            errorsOf[id].push_back(e);
+    }
+    for (int id : p.areaIds)
+        areaWeightOf[id] = p.areaWeight;
+    for (const AABB& o : p.obstacles) {
+        std::array<double, 6> box;
+        for (int k = 0; k < 3; ++k) {
+            box[k] = (o.lo[k] + o.hi[k]) / 2;
+            box[k + 3] = o.hi[k] - o.lo[k];
+        }
+        obstacleBoxes.push_back(box);
+    }
+}
+
+double Annealer::value(const ModelBuilder::Expr& e) const
+{
+    double result = e.constant;
+    for (int k = 0; k < e.size; ++k)
+        if (e.vars[k] >= 0)
+            result += e.coeffs[k] * v[e.vars[k]];
+    return result;
+}
+
+double Annealer::rowViolation(int r) const
+{
+    double val = value(p.rows[r].expr);
+    switch (p.rows[r].sense) {
+    case GRB_LESS_EQUAL: return std::max(0.0, val);
+    case GRB_GREATER_EQUAL: return std::max(0.0, -val);
+    default: return std::abs(val);
+    }
+}
+
+double Annealer::overlap(const double* a, const double* b) const
+{
+    // Penetration depth, 0 for boxes that are apart or touch on some axis
+    double depth = std::numeric_limits<double>::infinity();
+    for (int k = 0; k < dims; ++k) {
+        double d = (a[k + 3] + b[k + 3]) / 2 - std::abs(a[k] - b[k]);
+        if (d <= 0)
+            return 0;
+        depth = std::min(depth, d);
+    }
+    return depth;
+}
+
+double Annealer::cornerViolation(int i) const
+{
+    if (p.corners[i].empty())
+        return 0;
+    const double* b = &v[6 * i];
+    double x = b[0] + p.cornerSides[i][0] * b[3] / 2, y = b[1] + p.cornerSides[i][1] * b[4] / 2;
+    double best = std::numeric_limits<double>::infinity();
+    for (const auto& point : p.corners[i])
+        best = std::min(best, std::abs(x - point[0]) + std::abs(y - point[1]));
+    return best;
+}
+
+double Annealer::obstacleViolation(int i) const
+{
+    double total = 0;
+    for (const auto& box : obstacleBoxes)
+        total += overlap(&v[6 * i], box.data());
+    return total;
+}
+
+bool Annealer::ready(const std::vector<int>& ids) const
+{
+    return std::all_of(ids.begin(), ids.end(), [&](int id) { return placed[id] != 0; });
+}
+
+double Annealer::violationOf(int i) const
+{
+    double total = cornerViolation(i) + obstacleViolation(i);
+    for (int r : rowsOf[i])
+        if (ready(rowObjects[r]))
+            total += rowViolation(r);
+    for (int j = 0; j < n; ++j)
+        if (j != i && placed[j])
+            total += overlap(&v[6 * i], &v[6 * j]);
+    return total;
+}
+
+double Annealer::objectiveOf(int i) const
+{
+    double total = areaWeightOf[i] * boxArea(i);
+    for (int e : errorsOf[i]) {
+        if (!ready(errorObjects[e]))
+            continue;
+        double err = value(p.errors[e]);
+        total += p.errorWeights[e] * err * err;
+    }
+    return total;
+}
+
+void Annealer::clamp(int i)
+{
+    double* b = &v[6 * i];
+    const BoxRange& range = p.ranges[i];
+    for (int k = 0; k < dims; ++k) {
+        b[k + 3] = std::clamp(b[k + 3], range.smin[k], std::max(range.smin[k], range.smax[k]));
+        double lo = std::max(range.cmin[k], p.room.lo[k] + b[k + 3] / 2);
+        double hi = std::min(range.cmax[k], p.room.hi[k] - b[k + 3] / 2);
+        b[k] = lo <= hi ? std::clamp(b[k], lo, hi) : (lo + hi) / 2;
+    }
+    if (dims == 3 && p.support[i] == 0)
+        b[2] = p.room.lo[2] + b[5] / 2;
+    else if (dims == 3 && p.support[i] == 1)
+        b[2] = p.room.hi[2] - b[5] / 2;
+}
+
+void Annealer::repair(int i, int r)
+{
+    const ModelBuilder::Expr& e = p.rows[r].expr;
+    std::vector<int> own;
+    for (int k = 0; k < e.size; ++k)
+        if (e.vars[k] / 6 == i && active(e.vars[k]))
+            own.push_back(k);
+    if (own.empty())
+        return;
+    double val = value(e);
+    char sense = p.rows[r].sense;
+    if ((sense == GRB_LESS_EQUAL && val <= 0) || (sense == GRB_GREATER_EQUAL && val >= 0))
+        return;
+    int k = own[std::uniform_int_distribution<int>(0, own.size() - 1)(rng)];
+    v[e.vars[k]] -= val / e.coeffs[k];
+    clamp(i);
+}
+
+void Annealer::separate(int i)
+{
+    double* b = &v[6 * i];
+    for (int j = 0; j < n; ++j) {
+        if (j == i || !placed[j] || overlap(b, &v[6 * j]) <= 0)
+            continue;
+        const double* o = &v[6 * j];
+        int axis = 0;
+        double least = std::numeric_limits<double>::infinity();
+        for (int k = 0; k < dims; ++k) {
+            double d = (b[k + 3] + o[k + 3]) / 2 - std::abs(b[k] - o[k]);
+            if (d < least) {
+                least = d;
+                axis = k;
+            }
+        }
+        b[axis] += b[axis] >= o[axis] ? least : -least;
+        clamp(i);
+        return;
+    }
+}
+
+void Annealer::place(int i)
+{
+    // The best of a few random spots and of the spots that satisfy one of its rows, against the placed objects
+    placed[i] = 1;
+    std::vector<double> best(v.begin() + 6 * i, v.begin() + 6 * i + 6), start = best;
+    double bestCost = objectiveOf(i) + penalty * violationOf(i);
+    for (int trial = 0; trial < 24 + 2 * (int)rowsOf[i].size(); ++trial) {
+        std::copy(start.begin(), start.end(), v.begin() + 6 * i);
+        for (int k = 0; k < dims; ++k)
+            v[6 * i + k] = std::uniform_real_distribution<double>(p.room.lo[k], p.room.hi[k])(rng);
+        clamp(i);
+        if (!rowsOf[i].empty() && trial % 2 == 1) {
+            int r = rowsOf[i][trial / 2 % rowsOf[i].size()];
+            if (ready(rowObjects[r]))
+                repair(i, r);
+        }
+        separate(i);
+        double cost = objectiveOf(i) + penalty * violationOf(i);
+        if (cost < bestCost) {
+            bestCost = cost;
+            best.assign(v.begin() + 6 * i, v.begin() + 6 * i + 6);
+        }
+    }
+    std::copy(best.begin(), best.end(), v.begin() + 6 * i);
+}
+
+void Annealer::recompute()
+{
+    violation = objective = sumArea = 0;
+    for (int r = 0; r < (int)p.rows.size(); ++r)
+        violation += rowViolation(r);
+    for (int e = 0; e < (int)p.errors.size(); ++e) {
+        double err = value(p.errors[e]);
+        objective += p.errorWeights[e] * err * err;
+    }
+    for (int i = 0; i < n; ++i) {
+        violation += cornerViolation(i) + obstacleViolation(i);
+        for (int j = i + 1; j < n; ++j)
+            violation += overlap(&v[6 * i], &v[6 * j]);
+        objective += areaWeightOf[i] * boxArea(i);
+        sumArea += boxArea(i);
+    }
+    violation += areaViolation(sumArea);
+}
+
+HeuristicResult Annealer::run()
+{
+    auto start = std::chrono::steady_clock::now();
+    double size[3];
+    for (int k = 0; k < 3; ++k)
+        size[k] = p.room.hi[k] - p.room.lo[k];
+
+    // Hinted objects start at their hint, the others get a moderate size and are placed greedily,
+    // the most constrained first
+    std::vector<int> order;
+    for (int i = 0; i < n; ++i) {
+        const BoxRange& range = p.ranges[i];
+        if (!p.hints[i].empty()) {
+            std::copy(p.hints[i].begin(), p.hints[i].end(), v.begin() + 6 * i);
+        }
+        else {
+            double share = std::ceil(std::sqrt((double)n)) * 1.5;
+            for (int k = 0; k < dims; ++k) {
+                v[6 * i + k + 3] = std::max(range.smin[k], std::min(range.smax[k], size[k] / share));
+                v[6 * i + k] = (range.cmin[k] + range.cmax[k]) / 2;
+            }
+            order.push_back(i);
+        }
+        clamp(i);
+    }
+    for (int i = 0; i < n; ++i)
+        if (!p.hints[i].empty())
+            placed[i] = 1;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return rowsOf[a].size() > rowsOf[b].size(); });
+    for (int i : order)
+        place(i);
+    recompute();
+
+    std::vector<double> best = v;
+    double bestViolation = violation, bestObjective = objective;
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::normal_distribution<double> normal(0, 1);
+    const double t0 = 0.05, t1 = 1e-5;
+    int iteration = 0, stage = 0;
+    double progress = 0;
+    std::vector<double> saved(6);
+    for (; iteration < settings.maxIterations && n > 0; ++iteration) {
+        if (iteration % 256 == 0) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            progress = std::max((double)iteration / settings.maxIterations, elapsed / settings.timeLimit);
+            if (progress >= 1)
+                break;
+            // Raise the penalty while the current layout stays infeasible
+            if ((int)(progress * 20) > stage) {
+                stage = progress * 20;
+                if (violation > 1e-6 && penalty < 1e6)
+                    penalty *= 2;
+                recompute();
+            }
+        }
+        double temperature = t0 * std::pow(t1 / t0, progress), step = 0.2 * (1 - progress) + 0.005;
+        int i = std::uniform_int_distribution<int>(0, n - 1)(rng);
+        double* b = &v[6 * i];
+        std::copy(b, b + 6, saved.begin());
+        double oldViolation = violationOf(i), oldObjective = objectiveOf(i), oldArea = boxArea(i);
+
+        double move = unit(rng);
+        if (move < 0.35) {
+            for (int k = 0; k < dims; ++k)
+                if (unit(rng) < 0.6)
+                    b[k] += normal(rng) * step * size[k];
+        }
+        else if (move < 0.55) {
+            int k = std::uniform_int_distribution<int>(0, dims - 1)(rng);
+            b[k + 3] += normal(rng) * step * size[k];
+        }
+        else if (move < 0.8 && !rowsOf[i].empty()) {
+            int r = rowsOf[i][std::uniform_int_distribution<int>(0, rowsOf[i].size() - 1)(rng)];
+            repair(i, r);
+        }
+        else if (move < 0.9) {
+            separate(i);
+        }
+        else {
+            for (int k = 0; k < dims; ++k)
+                b[k] = std::uniform_real_distribution<double>(p.ranges[i].cmin[k], std::max(p.ranges[i].cmin[k], p.ranges[i].cmax[k]))(rng);
+        }
+        clamp(i);
+
+        double newArea = sumArea - oldArea + boxArea(i);
+        double dViolation = violationOf(i) - oldViolation + areaViolation(newArea) - areaViolation(sumArea);
+        double dObjective = objectiveOf(i) - oldObjective;
+        double delta = dObjective + penalty * dViolation;
+        if (delta > 0 && unit(rng) >= std::exp(-delta / temperature)) {
+            std::copy(saved.begin(), saved.end(), b);
+            continue;
+        }
+        violation += dViolation;
+        objective += dObjective;
+        sumArea = newArea;
+        bool feasible = violation <= 1e-6, bestFeasible = bestViolation <= 1e-6;
+        if ((feasible && (!bestFeasible || objective < bestObjective)) || (!feasible && !bestFeasible && violation < bestViolation)) {
+            best = v;
+            bestViolation = violation;
+            bestObjective = objective;
+        }
+    }
+
+    v = best;
+    recompute();
+    HeuristicResult result;
+    result.violation = violation;
+    result.objective = objective;
+    result.iterations = iteration;
+    result.boxes.resize(n);
+    for (int i = 0; i < n; ++i)
+        std::copy(v.begin() + 6 * i, v.begin() + 6 * i + 6, result.boxes[i].begin());
+    return result;
+}
+
+}
+
+HeuristicResult solveLayoutHeuristic(const LayoutProblem& problem, const HeuristicSettings& settings)
+{
+    return Annealer(problem, settings).run();
+}
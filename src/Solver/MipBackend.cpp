@@ -0,0 +1,161 @@
+#include "Components/MipBackend.h"
+
+#ifdef AUTOHOMEPLAN_WITH_HIGHS
+#include <Highs.h>
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+class HighsBackend : public MipBackend {
+public:
+    std::string name() const override { return "HiGHS"; }
+    MipResult solve(const ModelBuilder& model, const MipSettings& settings, const std::vector<double>& start) override;
+};
+
+static int gurobiStatus(HighsModelStatus status)
+{
+    switch (status) {
+    case HighsModelStatus::kOptimal: return GRB_OPTIMAL;
+    case HighsModelStatus::kInfeasible: return GRB_INFEASIBLE;
+    case HighsModelStatus::kUnboundedOrInfeasible: return GRB_INF_OR_UNBD;
+    case HighsModelStatus::kUnbounded: return GRB_UNBOUNDED;
+    case HighsModelStatus::kTimeLimit: return GRB_TIME_LIMIT;
+    case HighsModelStatus::kIterationLimit: return GRB_ITERATION_LIMIT;
+    case HighsModelStatus::kSolutionLimit: return GRB_SOLUTION_LIMIT;
+    case HighsModelStatus::kInterrupt: return GRB_INTERRUPTED;
+    default: return GRB_NUMERIC;
+    }
+}
+
+MipResult HighsBackend::solve(const ModelBuilder& model, const MipSettings& settings, const std::vector<double>& start)
+{
+    if (!model.quadRows.empty())
+        throw std::runtime_error("quadratic constraints are not supported");
+    int num_vars = model.lb.size(), num_rows = model.senses.size();
+    bool integral = std::any_of(model.types.begin(), model.types.end(), [](char t) { return t != GRB_CONTINUOUS; });
+    // HiGHS solves convex QPs, but its MIP solver only takes a linear objective
+    if (integral && !model.objectiveIsLinear())
+        throw std::runtime_error("a quadratic objective is only supported for models without binaries");
+
+    HighsModel highs_model;
+    HighsLp& lp = highs_model.lp_;
+    lp.num_col_ = num_vars;
+    lp.col_lower_ = model.lb;
+    lp.col_upper_ = model.ub;
+    lp.col_cost_.assign(num_vars, 0);
+    for (size_t k = 0; k < model.objCols.size(); ++k)
+        lp.col_cost_[model.objCols[k]] += model.objCoeffs[k];
+    lp.offset_ = model.objConstant;
+    lp.sense_ = ObjSense::kMinimize;
+    if (integral) {
+        lp.integrality_.resize(num_vars);
+        for (int j = 0; j < num_vars; ++j)
+            lp.integrality_[j] = model.types[j] == GRB_CONTINUOUS ? HighsVarType::kContinuous : HighsVarType::kInteger;
+    }
+
+    // HiGHS has no indicator constraints: b = 1 enforces the row, b = 0 relaxes it to the activity range of its
+    // terms, which is finite as every layout variable is bounded
+    HighsSparseMatrix& matrix = lp.a_matrix_;
+    matrix.format_ = MatrixFormat::kRowwise;
+    matrix.num_col_ = num_vars;
+    matrix.start_ = { 0 };
+    auto addRow = [&](int begin, int end, int bin, double bin_coeff, double lower, double upper) {
+        for (int k = begin; k < end; ++k) {
+            matrix.index_.push_back(model.cols[k]);
+            matrix.value_.push_back(model.coeffs[k]);
+        }
+        if (bin >= 0) {
+            matrix.index_.push_back(bin);
+            matrix.value_.push_back(bin_coeff);
+        }
+        matrix.start_.push_back(matrix.index_.size());
+        lp.row_lower_.push_back(lower);
+        lp.row_upper_.push_back(upper);
+    };
+    for (int r = 0; r < num_rows; ++r) {
+        int begin = model.rowBegin[r], end = r + 1 < num_rows ? model.rowBegin[r + 1] : model.cols.size();
+        char sense = model.senses[r];
+        double rhs = model.rhs[r];
+        int bin = model.rowIndicator[r];
+        if (bin < 0) {
+            addRow(begin, end, -1, 0, sense == GRB_LESS_EQUAL ? -kHighsInf : rhs, sense == GRB_GREATER_EQUAL ? kHighsInf : rhs);
+            continue;
+        }
+        double min_activity = 0, max_activity = 0;
+        for (int k = begin; k < end; ++k) {
+            double a = model.coeffs[k], lo = model.lb[model.cols[k]], hi = model.ub[model.cols[k]];
+            min_activity += a > 0 ? a * lo : a * hi;
+            max_activity += a > 0 ? a * hi : a * lo;
+        }
+        if (sense != GRB_GREATER_EQUAL)
+            addRow(begin, end, bin, max_activity - rhs, -kHighsInf, max_activity);
+        if (sense != GRB_LESS_EQUAL)
+            addRow(begin, end, bin, min_activity - rhs, min_activity, kHighsInf);
+    }
+    lp.num_row_ = lp.row_lower_.size();
+    matrix.num_row_ = lp.num_row_;
+
+    if (!model.objectiveIsLinear()) {
+        // Lower triangle of Q in objective 0.5 x'Qx, column by column
+        std::map<std::pair<int, int>, double> entries;
+        for (size_t k = 0; k < model.objFirst.size(); ++k) {
+            int i = model.objFirst[k], j = model.objSecond[k];
+            if (i == j)
+                entries[{ i, i }] += 2 * model.objQuadCoeffs[k];
+            else
+                entries[{ std::min(i, j), std::max(i, j) }] += model.objQuadCoeffs[k];
+        }
+        HighsHessian& hessian = highs_model.hessian_;
+        hessian.dim_ = num_vars;
+        hessian.format_ = HessianFormat::kTriangular;
+        hessian.start_.assign(num_vars + 1, 0);
+        for (const auto& entry : entries) {
+            hessian.start_[entry.first.first + 1]++;
+            hessian.index_.push_back(entry.first.second);
+            hessian.value_.push_back(entry.second);
+        }
+        for (int j = 0; j < num_vars; ++j)
+            hessian.start_[j + 1] += hessian.start_[j];
+    }
+
+    Highs highs;
+    highs.setOptionValue("output_flag", settings.verbose);
+    if (settings.threads > 0)
+        highs.setOptionValue("threads", settings.threads);
+    highs.setOptionValue("time_limit", settings.timeLimit);
+    highs.setOptionValue("mip_rel_gap", settings.mipGap);
+    if (highs.passModel(highs_model) == HighsStatus::kError)
+        throw std::runtime_error("HiGHS rejected the model");
+    if ((int)start.size() == num_vars) {
+        HighsSolution solution;
+        solution.col_value = start;
+        solution.value_valid = true;
+        highs.setSolution(solution);
+    }
+    highs.run();
+
+    MipResult result;
+    const HighsInfo& info = highs.getInfo();
+    result.status = gurobiStatus(highs.getModelStatus());
+    result.runtime = highs.getRunTime();
+    if (info.primal_solution_status == kSolutionStatusFeasible) {
+        result.solCount = 1;
+        result.values = highs.getSolution().col_value;
+        result.objective = info.objective_function_value;
+        result.mipGap = integral ? info.mip_gap : 0;
+    }
+    result.bound = integral ? info.mip_dual_bound : result.objective;
+    result.nodeCount = integral ? info.mip_node_count : 0;
+    return result;
+}
+#endif
+
+std::unique_ptr<MipBackend> makeHighsBackend()
+{
+#ifdef AUTOHOMEPLAN_WITH_HIGHS
+    return std::make_unique<HighsBackend>();
+#else
+    return nullptr;
+#endif
+}
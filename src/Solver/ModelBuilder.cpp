@@ -0,0 +1,229 @@
+#include "Components/ModelBuilder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+ModelBuilder::Expr& ModelBuilder::Expr::operator+=(const Expr& e)
+{
+    if (size + e.size > capacity)
+        throw std::length_error("ModelBuilder::Expr: too many terms, use beginRow/addTerm/endRow");
+    for (int k = 0; k < e.size; ++k) {
+        vars[size] = e.vars[k];
+        coeffs[size++] = e.coeffs[k];
+    }
+    constant += e.constant;
+    return *this;
+}
+
+ModelBuilder::Expr& ModelBuilder::Expr::operator-=(const Expr& e)
+{
+    Expr negated = e;
+    return *this += (negated *= -1);
+}
+
+ModelBuilder::Expr& ModelBuilder::Expr::operator*=(double c)
+{
+    for (int k = 0; k < size; ++k)
+        coeffs[k] *= c;
+    constant *= c;
+    return *this;
+}
+
+ModelBuilder::Var ModelBuilder::addVar(double lower, double upper, char type, const std::string& name)
+{
+    lb.push_back(lower);
+    ub.push_back(upper);
+    types.push_back(type);
+    varNames.push_back(name);
+    return { (int)lb.size() - 1 };
+}
+
+int ModelBuilder::addConstr(const Constr& c)
+{
+    beginRow();
+    for (int k = 0; k < c.expr.size; ++k)
+        addTerm({ c.expr.vars[k] }, c.expr.coeffs[k]);
+    return endRow(c.sense, -c.expr.constant);
+}
+
+int ModelBuilder::addIndicator(Var bin, const Constr& c)
+{
+    if (!bin.valid())
+        throw std::invalid_argument("ModelBuilder::addIndicator: variable was not created");
+    int row = addConstr(c);
+    rowIndicator.back() = bin.index;
+    numIndicatorRows++;
+    return row;
+}
+
+void ModelBuilder::addQuadConstr(const std::vector<Var>& first, const std::vector<Var>& second, const std::vector<double>& coeffs,
+    char sense, double rhs, const std::string& name)
+{
+    QuadRow row{ {}, {}, coeffs, sense, rhs, name };
+    for (size_t k = 0; k < first.size(); ++k) {
+        if (!first[k].valid() || !second[k].valid())
+            throw std::invalid_argument("ModelBuilder::addQuadConstr: variable was not created");
+        row.first.push_back(first[k].index);
+        row.second.push_back(second[k].index);
+    }
+    quadRows.push_back(std::move(row));
+}
+
+void ModelBuilder::clearObjective()
+{
+    objConstant = 0;
+    objCols.clear();
+    objCoeffs.clear();
+    objFirst.clear();
+    objSecond.clear();
+    objQuadCoeffs.clear();
+}
+
+void ModelBuilder::addObjective(const Expr& e)
+{
+    for (int k = 0; k < e.size; ++k) {
+        objCols.push_back(e.vars[k]);
+        objCoeffs.push_back(e.coeffs[k]);
+    }
+    objConstant += e.constant;
+}
+
+void ModelBuilder::addObjectiveSquare(const Expr& e, double coeff)
+{
+    // (sum a_k v_k + c)^2 = sum_k sum_l a_k a_l v_k v_l + 2 c sum_k a_k v_k + c^2
+    for (int k = 0; k < e.size; ++k) {
+        for (int l = k; l < e.size; ++l) {
+            objFirst.push_back(e.vars[k]);
+            objSecond.push_back(e.vars[l]);
+            objQuadCoeffs.push_back((k == l ? 1 : 2) * coeff * e.coeffs[k] * e.coeffs[l]);
+        }
+        objCols.push_back(e.vars[k]);
+        objCoeffs.push_back(2 * coeff * e.constant * e.coeffs[k]);
+    }
+    objConstant += coeff * e.constant * e.constant;
+}
+
+void ModelBuilder::addObjectiveProduct(Var a, Var b, double coeff)
+{
+    if (!a.valid() || !b.valid())
+        throw std::invalid_argument("ModelBuilder::addObjectiveProduct: variable was not created");
+    objFirst.push_back(a.index);
+    objSecond.push_back(b.index);
+    objQuadCoeffs.push_back(coeff);
+}
+
+void ModelBuilder::beginRow()
+{
+    rowBegin.push_back(cols.size());
+}
+
+void ModelBuilder::addTerm(Var v, double coeff)
+{
+    if (!v.valid())
+        throw std::invalid_argument("ModelBuilder::addTerm: variable was not created");
+    cols.push_back(v.index);
+    coeffs.push_back(coeff);
+}
+
+int ModelBuilder::endRow(char sense, double value)
+{
+    senses.push_back(sense);
+    rhs.push_back(value);
+    rowIndicator.push_back(-1);
+    return senses.size() - 1;
+}
+
+int ModelBuilder::numBinaries() const
+{
+    return std::count(types.begin(), types.end(), GRB_BINARY);
+}
+
+void ModelBuilder::reserve(int vars, int rows, int nonzeros)
+{
+    lb.reserve(vars);
+    ub.reserve(vars);
+    types.reserve(vars);
+    varNames.reserve(vars);
+    rowBegin.reserve(rows);
+    senses.reserve(rows);
+    rhs.reserve(rows);
+    rowIndicator.reserve(rows);
+    cols.reserve(nonzeros);
+    coeffs.reserve(nonzeros);
+}
+
+void ModelBuilder::flush(GRBModel& model, const std::vector<std::string>& rowNames, const std::vector<std::string>& indicatorNames,
+    std::vector<GRBVar>& vars, std::vector<GRBConstr>& constrs, std::vector<GRBGenConstr>& indicators)
+{
+    int num_vars = lb.size(), num_rows = senses.size();
+    GRBVar* added_vars = model.addVars(lb.data(), ub.data(), nullptr, types.data(), varNames.data(), num_vars);
+    vars.assign(added_vars, added_vars + num_vars);
+    delete[] added_vars;
+
+    // Gather the column handles once so every row is a contiguous addTerms call
+    std::vector<GRBVar> row_vars(cols.size());
+    for (size_t k = 0; k < cols.size(); ++k)
+        row_vars[k] = vars[cols[k]];
+    int num_linear = num_rows - numIndicatorRows;
+    std::vector<GRBLinExpr> exprs(num_linear);
+    std::vector<char> linear_senses(num_linear);
+    std::vector<double> linear_rhs(num_linear);
+    indicators.clear();
+    indicators.reserve(numIndicatorRows);
+    for (int r = 0, linear = 0; r < num_rows; ++r) {
+        int begin = rowBegin[r], end = r + 1 < num_rows ? rowBegin[r + 1] : cols.size();
+        if (rowIndicator[r] >= 0) {
+            GRBLinExpr expr;
+            expr.addTerms(coeffs.data() + begin, row_vars.data() + begin, end - begin);
+            const std::string& name = indicatorNames.empty() ? std::string() : indicatorNames[indicators.size()];
+            indicators.push_back(model.addGenConstrIndicator(vars[rowIndicator[r]], 1, expr, senses[r], rhs[r], name));
+            continue;
+        }
+        exprs[linear].addTerms(coeffs.data() + begin, row_vars.data() + begin, end - begin);
+        linear_senses[linear] = senses[r];
+        linear_rhs[linear++] = rhs[r];
+    }
+    GRBConstr* added_constrs = model.addConstrs(exprs.data(), linear_senses.data(), linear_rhs.data(),
+        rowNames.empty() ? nullptr : rowNames.data(), num_linear);
+    constrs.assign(added_constrs, added_constrs + num_linear);
+    delete[] added_constrs;
+    for (const QuadRow& row : quadRows) {
+        GRBQuadExpr expr;
+        for (size_t k = 0; k < row.coeffs.size(); ++k)
+            expr.addTerm(row.coeffs[k], vars[row.first[k]], vars[row.second[k]]);
+        model.addQConstr(expr, row.sense, row.rhs, row.name);
+    }
+}
+
+void ModelBuilder::flushObjective(GRBModel& model, const std::vector<GRBVar>& vars) const
+{
+    GRBQuadExpr obj = objConstant;
+    std::vector<GRBVar> first(objCols.size());
+    for (size_t k = 0; k < objCols.size(); ++k)
+        first[k] = vars[objCols[k]];
+    obj.addTerms(objCoeffs.data(), first.data(), objCols.size());
+    first.resize(objFirst.size());
+    std::vector<GRBVar> second(objSecond.size());
+    for (size_t k = 0; k < objFirst.size(); ++k) {
+        first[k] = vars[objFirst[k]];
+        second[k] = vars[objSecond[k]];
+    }
+    obj.addTerms(objQuadCoeffs.data(), first.data(), second.data(), objFirst.size());
+    model.setObjective(obj, GRB_MINIMIZE);
+}
+
+void ModelBuilder::clear()
+{
+    lb.clear();
+    ub.clear();
+    types.clear();
+    varNames.clear();
+    rowBegin.clear();
+    cols.clear();
+    coeffs.clear();
+    rhs.clear();
+    senses.clear();
+    rowIndicator.clear();
+    numIndicatorRows = 0;
+    quadRows.clear();
+}
@@ -1,532 +1,1649 @@
 #include "Components/Solver.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <boost/graph/graphviz.hpp>
+#include <chrono>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <thread>
 
 std::vector<std::string> show_edges = { "Left of", "Right of", "Front of", "Behind", "Above", "Under", "Close by", "Align with" };
 std::vector<std::string> show_orientations = { "up", "down", "left", "right", "front", "back" };
 
-Solver::Solver() : env(), model(env) {
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Adds its own lifetime in seconds to a SolveStats field
+class PhaseTimer {
+public:
+	explicit PhaseTimer(double& total) : total(total), start(std::chrono::steady_clock::now()) {}
+	~PhaseTimer() { total += secondsSince(start); }
+
+private:
+	double& total;
+	std::chrono::steady_clock::time_point start;
+};
+
+// Fresh statistics for a new solve, the readSceneGraph timings still describe the current scene
+SolveStats keepReadStats(const SolveStats& stats)
+{
+	SolveStats fresh;
+	fresh.parseTime = stats.parseTime;
+	fresh.clipperTime = stats.clipperTime;
+	fresh.processTime = stats.processTime;
+	return fresh;
+}
+
+}
+
+// Publishes the progress and every new incumbent of the model of a Solver and stops it on cancel().
+// The progress of a sub-solver model goes to the Solver that runs it (report).
+class SolveCallback : public GRBCallback {
+public:
+	explicit SolveCallback(Solver& solver) : solver(solver), report(solver) {}
+	SolveCallback(Solver& solver, Solver& report) : solver(solver), report(report) {}
+
+protected:
+	void callback() override
+	{
+		if (solver.cancelled()) {
+			abort();
+			return;
+		}
+		if (where == GRB_CB_MIP) {
+			report.publishProgress(getDoubleInfo(GRB_CB_RUNTIME), getDoubleInfo(GRB_CB_MIP_OBJBST), getDoubleInfo(GRB_CB_MIP_OBJBND),
+				getDoubleInfo(GRB_CB_MIP_NODCNT), getIntInfo(GRB_CB_MIP_SOLCNT));
+			return;
+		}
+		if (where != GRB_CB_MIPSOL || solver.vars.empty())
+			return;
+		double* values = getSolution(solver.vars.data(), solver.vars.size());
+		std::vector<double> solution(values, values + solver.vars.size());
+		delete[] values;
+		if (!solver.lazyPairs.empty()) {
+			// An incumbent with overlapping objects is rejected by its lazy rows and not published
+			std::vector<ModelBuilder::Constr> rows;
+			solver.separateOverlaps(solution, rows);
+			for (const ModelBuilder::Constr& row : rows)
+				addLazy(solver.linExpr(row.expr), row.sense, 0);
+			if (!rows.empty())
+				return;
+		}
+		solver.publishIncumbent(solution, getDoubleInfo(GRB_CB_MIPSOL_OBJ), getDoubleInfo(GRB_CB_MIPSOL_OBJBND), getDoubleInfo(GRB_CB_RUNTIME));
+	}
+
+private:
+	Solver& solver;
+	Solver& report;
+};
+
+nlohmann::json SolveStats::toJson() const
+{
+	return {
+		{ "time", {
+			{ "parse", parseTime }, { "clipper", clipperTime }, { "process", processTime },
+			{ "pair_filter", pairFilterTime }, { "build", buildTime }, { "warm_start", warmStartTime },
+			{ "optimize", optimizeTime }, { "iis", iisTime }, { "heuristic", heuristicTime }, { "save", saveTime } } },
+		{ "model", {
+			{ "variables", numVars }, { "binaries", numBinVars }, { "constraints", numConstrs },
+			{ "quadratic_constraints", numQConstrs }, { "general_constraints", numGenConstrs },
+			{ "nonzeros", numNZs }, { "quadratic_terms", numQNZs }, { "candidate_pairs", candidatePairs },
+			{ "nonoverlap_pairs", nonOverlapPairs }, { "obstacle_pairs", obstaclePairs }, { "lazy_pairs", lazyPairs } } },
+		{ "result", {
+			{ "status", status }, { "solutions", solCount }, { "node_count", nodeCount },
+			{ "mip_gap", mipGap }, { "runtime", runtime }, { "objective", objective }, { "heuristic", heuristic } } }
+	};
+}
+
+Solver::Solver() : reachabilityWords(0), modelBuilt(false), needsRebuild(false) {
     // Initialize solver-related data if needed
     hyperparameters = {0.5, 1, 1, 1};
 	scalingFactor = 3;
+	saveDebugFiles = true;
+	verbose = true;
+	threads = 0;
+	nameConstraints = true;
+	warmStart = true;
+	timeLimit = 10;
+	pruneDisjunctions = true;
+	disjunctionMode = DisjunctionMode::BigM;
+	breakSymmetry = true;
+	decompose = false;
+	coarseToFine = true;
+	coarseMargin = 0.1;
+	portfolio = 0;
+	streamIncumbents = false;
+	incumbentCount = 0;
+	cancelRequested = false;
+	cancelFlag = &cancelRequested;
+	solveStart = std::chrono::steady_clock::now();
+	conflictPolicy = ConflictPolicy::Report;
+	backend = MipBackendType::Gurobi;
+	objectiveMode = ObjectiveMode::Quadratic;
+	modelObjective = objectiveMode;
+	areaSegments = 4;
+	lazyNonOverlap = false;
+	heuristicStart = false;
+	heuristicFallback = true;
+	heuristicTimeLimit = 0.2;
+	iisPrecheck = true;
 }
 
 Solver::~Solver() {}
 
-bool Solver::has_path(const SceneGraph& g, VertexDescriptor start, VertexDescriptor target)
+// Number of directional edge types (LeftOf, RightOf, FrontOf, Behind, Above, Under) tracked by the reachability index
+static const int num_directional_types = 6;
+
+void Solver::findSymmetryClasses()
 {
-    std::vector<bool> visited_1(boost::num_vertices(g), false), visited_2(boost::num_vertices(g), false),
-		visited_3(boost::num_vertices(g), false), visited_4(boost::num_vertices(g), false),
-		visited_5(boost::num_vertices(g), false), visited_6(boost::num_vertices(g), false);
-	return (dfs_check_path(g, start, target, LeftOf, visited_1) || dfs_check_path(g, start, target, RightOf, visited_1) || 
-		dfs_check_path(g, start, target, FrontOf, visited_3) || dfs_check_path(g, start, target, Behind, visited_4) || 
-		dfs_check_path(g, start, target, Above, visited_5) || dfs_check_path(g, start, target, Under, visited_6));
+	// Objects are interchangeable when all their properties and all their incident edges (type, direction,
+	// other end, distance, alignment, offset) are equal. The key strings group them.
+	int n = boost::num_vertices(g);
+	std::vector<std::string> keys(n);
+	std::vector<std::vector<std::string>> edge_keys(n);
+	auto values = [](std::ostringstream& out, const std::vector<double>& v) {
+		out << v.size();
+		for (double x : v)
+			out << "," << x;
+		out << ";";
+	};
+	EdgeIterator ei, ei_end;
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+		int s = g[boost::source(*ei, g)].id, t = g[boost::target(*ei, g)].id;
+		for (int end = 0; end < 2; ++end) {
+			std::ostringstream out;
+			out.precision(17);
+			out << g[*ei].type << (end == 0 ? ">" : "<") << (end == 0 ? t : s) << ":" << g[*ei].distance << ":" << g[*ei].align_edge << ":";
+			values(out, g[*ei].xyoffset);
+			edge_keys[end == 0 ? s : t].push_back(out.str());
+		}
+	}
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		const VertexProperties& vp = g[*vi];
+		std::ostringstream out;
+		out.precision(17);
+		out << vp.label << "|" << vp.boundary << "|" << vp.corner << "|" << vp.orientation << "|" << vp.on_floor << vp.hanging << "|";
+		for (const std::vector<double>* v : { &vp.target_pos, &vp.target_size, &vp.pos_tolerance, &vp.size_tolerance })
+			values(out, *v);
+		std::vector<std::string>& incident = edge_keys[vp.id];
+		std::sort(incident.begin(), incident.end());
+		for (const std::string& e : incident)
+			out << "|" << e;
+		keys[vp.id] = out.str();
+	}
+
+	std::map<std::string, std::vector<int>> groups;
+	for (int id = 0; id < n; ++id)
+		groups[keys[id]].push_back(id);
+	symmetryClasses.clear();
+	symmetryClassOf.assign(n, -1);
+	for (auto& [key, members] : groups) {
+		if (members.size() < 2)
+			continue;
+		// An edge inside the class tells its members apart
+		bool linked = false;
+		for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end && !linked; ++ei)
+			linked = keys[g[boost::source(*ei, g)].id] == key && keys[g[boost::target(*ei, g)].id] == key;
+		if (linked)
+			continue;
+		for (int id : members)
+			symmetryClassOf[id] = symmetryClasses.size();
+		symmetryClasses.push_back(members);
+	}
 }
 
-bool Solver::dfs_check_path(const SceneGraph& g, VertexDescriptor u, VertexDescriptor target, EdgeType required_type, std::vector<bool>& visited)
+void Solver::buildReachability()
 {
-	if (g[u].id == g[target].id) return true;
-	visited[g[u].id] = true;
+	int n = boost::num_vertices(g);
+	reachabilityWords = (n + 63) / 64;
+	reachability.assign(static_cast<size_t>(num_directional_types) * n * reachabilityWords, 0);
 
-	for (const auto& edge : boost::make_iterator_range(boost::out_edges(u, g))) {
-		VertexDescriptor v = boost::target(edge, g);
-		if (!visited[g[v].id] && g[edge].type == required_type) {
-			if (dfs_check_path(g, v, target, required_type, visited)) {
-				return true;
+	std::vector<std::vector<int>> successors(n);
+	std::vector<int> indegree(n), order, stack;
+	order.reserve(n);
+	for (int t = 0; t < num_directional_types; ++t) {
+		for (auto& s : successors)
+			s.clear();
+		std::fill(indegree.begin(), indegree.end(), 0);
+		EdgeIterator ei, ei_end;
+		for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+			if (g[*ei].type != t)
+				continue;
+			int u = g[boost::source(*ei, g)].id, v = g[boost::target(*ei, g)].id;
+			successors[u].push_back(v);
+			indegree[v]++;
+		}
+		std::uint64_t* rows = reachability.data() + static_cast<size_t>(t) * n * reachabilityWords;
+
+		// Kahn's algorithm: on a DAG every row is the union of its successors' rows
+		order.clear();
+		for (int u = 0; u < n; ++u)
+			if (indegree[u] == 0)
+				order.push_back(u);
+		for (size_t k = 0; k < order.size(); ++k)
+			for (int v : successors[order[k]])
+				if (--indegree[v] == 0)
+					order.push_back(v);
+
+		if (order.size() == static_cast<size_t>(n)) {
+			for (auto k = order.rbegin(); k != order.rend(); ++k) {
+				std::uint64_t* row = rows + static_cast<size_t>(*k) * reachabilityWords;
+				for (int v : successors[*k]) {
+					const std::uint64_t* row_v = rows + static_cast<size_t>(v) * reachabilityWords;
+					row[v / 64] |= std::uint64_t(1) << (v % 64);
+					for (int w = 0; w < reachabilityWords; ++w)
+						row[w] |= row_v[w];
+				}
+			}
+		}
+		else {
+			// Cycles left in the graph: fall back to one traversal per source vertex
+			for (int s = 0; s < n; ++s) {
+				std::uint64_t* row = rows + static_cast<size_t>(s) * reachabilityWords;
+				stack.assign(1, s);
+				while (!stack.empty()) {
+					int u = stack.back();
+					stack.pop_back();
+					for (int v : successors[u]) {
+						std::uint64_t bit = std::uint64_t(1) << (v % 64);
+						if (!(row[v / 64] & bit)) {
+							row[v / 64] |= bit;
+							stack.push_back(v);
+						}
+					}
+				}
 			}
 		}
 	}
+}
+
+bool Solver::has_path(int source_id, int target_id) const
+{
+	if (source_id == target_id)
+		return true;
+	int n = boost::num_vertices(g);
+	size_t word = target_id / 64;
+	std::uint64_t bit = std::uint64_t(1) << (target_id % 64);
+	for (int t = 0; t < num_directional_types; ++t) {
+		if (reachability[(static_cast<size_t>(t) * n + source_id) * reachabilityWords + word] & bit)
+			return true;
+	}
 	return false;
 }
 
+void Solver::addConstr(const ModelBuilder::Constr& constr, const ConstraintTag& tag)
+{
+	builder.addConstr(constr);
+	constraintTags.push_back(tag);
+}
+
+void Solver::addIndicator(ModelBuilder::Var bin, const ModelBuilder::Constr& constr, const ConstraintTag& tag)
+{
+	builder.addIndicator(bin, constr);
+	indicatorTags.push_back(tag);
+}
+
+void Solver::addRow(char sense, double rhs, const ConstraintTag& tag)
+{
+	builder.endRow(sense, rhs);
+	constraintTags.push_back(tag);
+}
+
+std::string Solver::constraintName(const ConstraintTag& tag) const
+{
+	static const char* axis_parts[] = { "_x_left", "_x_right", "_y_back", "_y_front", "_z_bottom", "_z_top" };
+	static const char* size_parts[] = { "_l_min", "_l_max", "_w_min", "_w_max", "_h_min", "_h_max" };
+	static const char* closeby_parts[] = { "ieqa", "ieqb", "ieqc", "ieqd", "ieqe" };
+	static const char* nonoverlap_parts[] = { "R", "L", "F", "B", "U", "D", "" };
+	static const char* obstacle_parts[] = { "L", "R", "B", "F", "D", "U", "" };
+	static const char* wall_names[] = { "Up", "Down", "Left", "Right", "Front", "Back" };
+	static const char* boundary_parts[] = { "_eq", "_ieq", "_ieqq" };
+	static const char* corner_names[] = { "TopLeft", "TopRight", "BottomLeft", "BottomRight" };
+	static const char* corner_parts[] = { "eqa", "eqb", "eqc" };
+	static const char* area_parts[] = { "_ub_a", "_ub_b", "_lb_a", "_lb_b", "_l_min", "_l_max", "_choice" };
+
+	std::string first = std::to_string(tag.first);
+	switch (tag.kind)
+	{
+	case ConstraintKind::Inside:
+		return "Inside_Object_" + first + axis_parts[tag.part];
+	case ConstraintKind::PosTolerance:
+		return "Pos_Tolerance_Object_" + first + axis_parts[tag.part];
+	case ConstraintKind::SizeTolerance:
+		return "Size_Tolerance_Object_" + first + size_parts[tag.part];
+	case ConstraintKind::OnFloor:
+		return "On_Floor_Object_" + first;
+	case ConstraintKind::Hanging:
+		return "Hanging_Object_" + first;
+	case ConstraintKind::Relation:
+		return "Object_" + first + "_" + graphProcessor.edgenames[tag.part] + "_Object_" + std::to_string(tag.second);
+	case ConstraintKind::CloseBy:
+		return "Object_" + first + "_CloseBy_Object_" + std::to_string(tag.second) + closeby_parts[tag.part];
+	case ConstraintKind::NonOverlap:
+		return "NonOverlap_Object_" + first + "and_Object_" + std::to_string(tag.second) + nonoverlap_parts[tag.part];
+	case ConstraintKind::Obstacle:
+		return "NonOverlap_Object_" + first + "and_Obstacle_" + std::to_string(tag.second) + obstacle_parts[tag.part];
+	case ConstraintKind::Boundary:
+		return "Boundary_Object_" + first + "_" + wall_names[tag.second] + boundary_parts[tag.part];
+	case ConstraintKind::Corner:
+		return std::string(corner_names[tag.second]) + "_Corner_of_Object_" + first + corner_parts[tag.part];
+	case ConstraintKind::Symmetry:
+		return "Symmetry_Object_" + first + "_before_Object_" + std::to_string(tag.second);
+	case ConstraintKind::ObjectiveError:
+		return "Objective_Error_" + first + (tag.part == 0 ? "_pos" : "_neg");
+	case ConstraintKind::Area:
+		if (tag.first < 0)
+			return "Area_Constraint_for_FloorPlan";
+		return "Area_Object_" + first + (tag.second >= 0 ? "_segment_" + std::to_string(tag.second) : "") + area_parts[tag.part];
+	}
+	return "";
+}
+
 void Solver::addConstraints()
 {
 	int num_vertices = boost::num_vertices(g);
 	int num_obstacles = obstacles.size();
-	double M = boundary.size[0] + boundary.size[1] + boundary.size[2];
-	std::vector<GRBVar> x_i(num_vertices), y_i(num_vertices), z_i(num_vertices),
-		l_i(num_vertices), w_i(num_vertices), h_i(num_vertices);
-	std::vector<std::vector<GRBVar>> sigma_L(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_R(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_F(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_B(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_U(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_D(num_vertices, std::vector<GRBVar>(num_vertices)),
-		L(num_vertices, std::vector<GRBVar>(num_vertices)),
-		R(num_vertices, std::vector<GRBVar>(num_vertices)),
-		F(num_vertices, std::vector<GRBVar>(num_vertices)),
-		B(num_vertices, std::vector<GRBVar>(num_vertices)),
-		sigma_oL(num_vertices, std::vector<GRBVar>(num_obstacles)),
-		sigma_oR(num_vertices, std::vector<GRBVar>(num_obstacles)),
-		sigma_oF(num_vertices, std::vector<GRBVar>(num_obstacles)),
-		sigma_oB(num_vertices, std::vector<GRBVar>(num_obstacles)),
-		sigma_oU(num_vertices, std::vector<GRBVar>(num_obstacles)),
-		sigma_oD(num_vertices, std::vector<GRBVar>(num_obstacles));
+	for (auto* handles : { &x_i, &y_i, &z_i, &l_i, &w_i, &h_i })
+		handles->assign(num_vertices, GRBVar());
+	nonOverlapPairs.clear();
+	obstaclePairs.clear();
+	lazyPairs.clear();
+	// Variables and rows are staged in the builder and only become Gurobi objects at the end
+	if (backend == MipBackendType::Gurobi && !model) {
+		env = std::make_unique<GRBEnv>();
+		model = std::make_unique<GRBModel>(*env);
+	}
+	builder.clear();
+	builder.reserve(6 * num_vertices, 12 * num_vertices, 24 * num_vertices);
+	std::vector<ModelBuilder::Var> xv(num_vertices), yv(num_vertices), zv(num_vertices),
+		lv(num_vertices), wv(num_vertices), hv(num_vertices);
 	for (int i = 0; i < num_vertices; ++i) {
-		x_i[i] = model.addVar(boundary.origin_pos[0], boundary.origin_pos[0] + boundary.size[0], 0.0, GRB_CONTINUOUS, "x_" + std::to_string(i));
-		y_i[i] = model.addVar(boundary.origin_pos[1], boundary.origin_pos[1] + boundary.size[1], 0.0, GRB_CONTINUOUS, "y_" + std::to_string(i));
-		l_i[i] = model.addVar(0.0, boundary.size[0], 0.0, GRB_CONTINUOUS, "l_" + std::to_string(i));
-		w_i[i] = model.addVar(0.0, boundary.size[1], 0.0, GRB_CONTINUOUS, "w_" + std::to_string(i));
+		xv[i] = builder.addVar(boundary.origin_pos[0], boundary.origin_pos[0] + boundary.size[0], GRB_CONTINUOUS, "x_" + std::to_string(i));
+		yv[i] = builder.addVar(boundary.origin_pos[1], boundary.origin_pos[1] + boundary.size[1], GRB_CONTINUOUS, "y_" + std::to_string(i));
+		lv[i] = builder.addVar(0.0, boundary.size[0], GRB_CONTINUOUS, "l_" + std::to_string(i));
+		wv[i] = builder.addVar(0.0, boundary.size[1], GRB_CONTINUOUS, "w_" + std::to_string(i));
 		if (!floorplan) {
-			z_i[i] = model.addVar(boundary.origin_pos[2], boundary.origin_pos[2] + boundary.size[2], 0.0, GRB_CONTINUOUS, "z_" + std::to_string(i));
-			h_i[i] = model.addVar(0.0, boundary.size[2], 0.0, GRB_CONTINUOUS, "h_" + std::to_string(i));
+			zv[i] = builder.addVar(boundary.origin_pos[2], boundary.origin_pos[2] + boundary.size[2], GRB_CONTINUOUS, "z_" + std::to_string(i));
+			hv[i] = builder.addVar(0.0, boundary.size[2], GRB_CONTINUOUS, "h_" + std::to_string(i));
 		}
 	}
+	boxVars.resize(num_vertices);
+	for (int i = 0; i < num_vertices; ++i)
+		boxVars[i] = { xv[i], yv[i], zv[i], lv[i], wv[i], hv[i] };
 	// Inside Constraints & tolerance Constraint
 	VertexIterator vi, vi_end;
 	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-		model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 >= boundary.origin_pos[0], "Inside_Object_" + std::to_string(g[*vi].id) + "_x_left");
-		model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 <= boundary.origin_pos[0] + boundary.size[0], "Inside_Object_" + std::to_string(g[*vi].id) + "_x_right");
-		model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 >= boundary.origin_pos[1], "Inside_Object_" + std::to_string(g[*vi].id) + "_y_back");
-		model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 <= boundary.origin_pos[1] + boundary.size[1], "Inside_Object_" + std::to_string(g[*vi].id) + "_y_front");
+		addConstr(xv[g[*vi].id] - lv[g[*vi].id] / 2 >= boundary.origin_pos[0], { ConstraintKind::Inside, g[*vi].id, -1, 0 });
+		addConstr(xv[g[*vi].id] + lv[g[*vi].id] / 2 <= boundary.origin_pos[0] + boundary.size[0], { ConstraintKind::Inside, g[*vi].id, -1, 1 });
+		addConstr(yv[g[*vi].id] - wv[g[*vi].id] / 2 >= boundary.origin_pos[1], { ConstraintKind::Inside, g[*vi].id, -1, 2 });
+		addConstr(yv[g[*vi].id] + wv[g[*vi].id] / 2 <= boundary.origin_pos[1] + boundary.size[1], { ConstraintKind::Inside, g[*vi].id, -1, 3 });
 		if (!floorplan) {
-			model.addConstr(z_i[g[*vi].id] - h_i[g[*vi].id] / 2 >= boundary.origin_pos[2], "Inside_Object_" + std::to_string(g[*vi].id) + "_z_bottom");
-			model.addConstr(z_i[g[*vi].id] + h_i[g[*vi].id] / 2 <= boundary.origin_pos[2] + boundary.size[2], "Inside_Object_" + std::to_string(g[*vi].id) + "_z_top");
+			addConstr(zv[g[*vi].id] - hv[g[*vi].id] / 2 >= boundary.origin_pos[2], { ConstraintKind::Inside, g[*vi].id, -1, 4 });
+			addConstr(zv[g[*vi].id] + hv[g[*vi].id] / 2 <= boundary.origin_pos[2] + boundary.size[2], { ConstraintKind::Inside, g[*vi].id, -1, 5 });
 		}
 		if (!g[*vi].pos_tolerance.empty() && !g[*vi].target_pos.empty()) {
-			model.addConstr(x_i[g[*vi].id] >= g[*vi].target_pos[0] - g[*vi].pos_tolerance[0], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_x_left");
-			model.addConstr(x_i[g[*vi].id] <= g[*vi].target_pos[0] + g[*vi].pos_tolerance[0], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_x_right");
-			model.addConstr(y_i[g[*vi].id] >= g[*vi].target_pos[1] - g[*vi].pos_tolerance[1], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_y_back");
-			model.addConstr(y_i[g[*vi].id] <= g[*vi].target_pos[1] + g[*vi].pos_tolerance[1], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_y_front");
+			addConstr(xv[g[*vi].id] >= g[*vi].target_pos[0] - g[*vi].pos_tolerance[0], { ConstraintKind::PosTolerance, g[*vi].id, -1, 0 });
+			addConstr(xv[g[*vi].id] <= g[*vi].target_pos[0] + g[*vi].pos_tolerance[0], { ConstraintKind::PosTolerance, g[*vi].id, -1, 1 });
+			addConstr(yv[g[*vi].id] >= g[*vi].target_pos[1] - g[*vi].pos_tolerance[1], { ConstraintKind::PosTolerance, g[*vi].id, -1, 2 });
+			addConstr(yv[g[*vi].id] <= g[*vi].target_pos[1] + g[*vi].pos_tolerance[1], { ConstraintKind::PosTolerance, g[*vi].id, -1, 3 });
 			if (!floorplan) {
-				model.addConstr(z_i[g[*vi].id] >= g[*vi].target_pos[2] - g[*vi].pos_tolerance[2], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_z_bottom");
-				model.addConstr(z_i[g[*vi].id] <= g[*vi].target_pos[2] + g[*vi].pos_tolerance[2], "Pos_Tolerance_Object_" + std::to_string(g[*vi].id) + "_z_top");
+				addConstr(zv[g[*vi].id] >= g[*vi].target_pos[2] - g[*vi].pos_tolerance[2], { ConstraintKind::PosTolerance, g[*vi].id, -1, 4 });
+				addConstr(zv[g[*vi].id] <= g[*vi].target_pos[2] + g[*vi].pos_tolerance[2], { ConstraintKind::PosTolerance, g[*vi].id, -1, 5 });
 			}
 		}
 		if (!g[*vi].size_tolerance.empty() && !g[*vi].target_size.empty()) {
-			model.addConstr(l_i[g[*vi].id] >= g[*vi].target_size[0] - g[*vi].size_tolerance[0], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_l_min");
-			model.addConstr(l_i[g[*vi].id] <= g[*vi].target_size[0] + g[*vi].size_tolerance[0], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_l_max");
-			model.addConstr(w_i[g[*vi].id] >= g[*vi].target_size[1] - g[*vi].size_tolerance[1], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_w_min");
-			model.addConstr(w_i[g[*vi].id] <= g[*vi].target_size[1] + g[*vi].size_tolerance[1], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_w_max");
+			addConstr(lv[g[*vi].id] >= g[*vi].target_size[0] - g[*vi].size_tolerance[0], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 0 });
+			addConstr(lv[g[*vi].id] <= g[*vi].target_size[0] + g[*vi].size_tolerance[0], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 1 });
+			addConstr(wv[g[*vi].id] >= g[*vi].target_size[1] - g[*vi].size_tolerance[1], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 2 });
+			addConstr(wv[g[*vi].id] <= g[*vi].target_size[1] + g[*vi].size_tolerance[1], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 3 });
 			if (!floorplan) {
-				model.addConstr(h_i[g[*vi].id] >= g[*vi].target_size[2] - g[*vi].size_tolerance[2], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_h_min");
-				model.addConstr(h_i[g[*vi].id] <= g[*vi].target_size[2] + g[*vi].size_tolerance[2], "Size_Tolerance_Object_" + std::to_string(g[*vi].id) + "_h_max");
+				addConstr(hv[g[*vi].id] >= g[*vi].target_size[2] - g[*vi].size_tolerance[2], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 4 });
+				addConstr(hv[g[*vi].id] <= g[*vi].target_size[2] + g[*vi].size_tolerance[2], { ConstraintKind::SizeTolerance, g[*vi].id, -1, 5 });
 			}
 		}
 	}
 	// On floor Constraints
 	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
 		if (g[*vi].on_floor && !floorplan) {
-			model.addConstr(z_i[g[*vi].id] == boundary.origin_pos[2] + h_i[g[*vi].id] / 2, "On_Floor_Object_" + std::to_string(g[*vi].id));
+			addConstr(zv[g[*vi].id] == boundary.origin_pos[2] + hv[g[*vi].id] / 2, { ConstraintKind::OnFloor, g[*vi].id, -1, 0 });
 		}
 	}
 	// Hanging Constraints
 	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
 		if (g[*vi].hanging && !floorplan) {
-			model.addConstr(z_i[g[*vi].id] == boundary.origin_pos[2] + boundary.size[2] - h_i[g[*vi].id] / 2, "Hanging_Object_" + std::to_string(g[*vi].id));
+			addConstr(zv[g[*vi].id] == boundary.origin_pos[2] + boundary.size[2] - hv[g[*vi].id] / 2, { ConstraintKind::Hanging, g[*vi].id, -1, 0 });
 		}
 	}
+	// Symmetry breaking: members of a class of interchangeable objects are ordered by x in id order
+	findSymmetryClasses();
+	if (breakSymmetry) {
+		for (const std::vector<int>& members : symmetryClasses)
+			for (size_t k = 0; k + 1 < members.size(); ++k)
+				addConstr(xv[members[k]] <= xv[members[k + 1]], { ConstraintKind::Symmetry, members[k], members[k + 1], 0 });
+	}
+	// Reachable centers/sizes per object, they bound the big-M values and drive the pruning below
+	int dims = floorplan ? 2 : 3;
+	std::vector<BoxRange> ranges(num_vertices);
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi)
+		ranges[g[*vi].id] = objectRange(g[*vi]);
 	// Adjacency Constraints
 	EdgeIterator ei, ei_end;
 	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
 		VertexDescriptor source = boost::source(*ei, g);
 		VertexDescriptor target = boost::target(*ei, g);
 		int ids = g[source].id, idt = g[target].id;
-		switch(g[*ei].type)
-		{
-		case LeftOf:
-			if (g[*ei].distance >= 0)
-				model.addConstr(x_i[ids] + l_i[ids] / 2 <= x_i[idt] - l_i[idt] / 2, "Object_" + std::to_string(ids) + "_LeftOf_Object_" + std::to_string(idt));
-			else
-				model.addConstr(x_i[ids] + l_i[ids] / 2 == x_i[idt] - l_i[idt] / 2, "Object_" + std::to_string(ids) + "_LeftOf_Object_" + std::to_string(idt));
-			break;
-		case RightOf:
-			if (g[*ei].distance >= 0)
-				model.addConstr(x_i[ids] - l_i[ids] / 2 >= x_i[idt] + l_i[idt] / 2, "Object_" + std::to_string(ids) + "_RightOf_Object_" + std::to_string(idt));
-			else
-				model.addConstr(x_i[ids] - l_i[ids] / 2 == x_i[idt] + l_i[idt] / 2, "Object_" + std::to_string(ids) + "_RightOf_Object_" + std::to_string(idt));
-			break;
-		case Behind:
-			if (g[*ei].distance >= 0)
-				model.addConstr(y_i[ids] + w_i[ids] / 2 <= y_i[idt] - w_i[idt] / 2, "Object_" + std::to_string(ids) + "_Behind_Object_" + std::to_string(idt));
-			else
-				model.addConstr(y_i[ids] + w_i[ids] / 2 == y_i[idt] - w_i[idt] / 2, "Object_" + std::to_string(ids) + "_Behind_Object_" + std::to_string(idt));
-			break;
-		case FrontOf:
-			if (g[*ei].distance >= 0)
-				model.addConstr(y_i[ids] - w_i[ids] / 2 >= y_i[idt] + w_i[idt] / 2, "Object_" + std::to_string(ids) + "_FrontOf_Object_" + std::to_string(idt));
-			else
-				model.addConstr(y_i[ids] - w_i[ids] / 2 == y_i[idt] + w_i[idt] / 2, "Object_" + std::to_string(ids) + "_FrontOf_Object_" + std::to_string(idt));
-			break;
-		case Under:
-			model.addConstr(z_i[ids] + h_i[ids] / 2 == z_i[idt] - h_i[idt] / 2, "Object_" + std::to_string(ids) + "_Under_Object_" + std::to_string(idt));
-			break;
-		case Above:
-			model.addConstr(z_i[ids] - h_i[ids] / 2 == z_i[idt] + h_i[idt] / 2, "Object_" + std::to_string(ids) + "_Above_Object_" + std::to_string(idt));
-			break;
-		case CloseBy:
-			L[ids][idt] = model.addVar(0, 1, 0, GRB_BINARY);
-			R[ids][idt] = model.addVar(0, 1, 0, GRB_BINARY);
-			F[ids][idt] = model.addVar(0, 1, 0, GRB_BINARY);
-			B[ids][idt] = model.addVar(0, 1, 0, GRB_BINARY);
-			model.addConstr(x_i[ids] - l_i[ids] / 2 <= x_i[idt] + l_i[idt] / 2 + M * (1 - R[ids][idt]), "Object_" + std::to_string(ids) + "_CloseBy_Object_" + std::to_string(idt) + "ieqa");
-			model.addConstr(x_i[ids] + l_i[ids] / 2 >= x_i[idt] - l_i[idt] / 2 - M * (1 - L[ids][idt]), "Object_" + std::to_string(ids) + "_CloseBy_Object_" + std::to_string(idt) + "ieqb");
-			model.addConstr(y_i[ids] - w_i[ids] / 2 <= y_i[idt] + w_i[idt] / 2 + M * (1 - F[ids][idt]), "Object_" + std::to_string(ids) + "_CloseBy_Object_" + std::to_string(idt) + "ieqc");
-			model.addConstr(y_i[ids] + w_i[ids] / 2 >= y_i[idt] - w_i[idt] / 2 - M * (1 - B[ids][idt]), "Object_" + std::to_string(ids) + "_CloseBy_Object_" + std::to_string(idt) + "ieqd");
-			model.addConstr(L[ids][idt] + R[ids][idt] + F[ids][idt] + B[ids][idt] <= 1, "Object_" + std::to_string(ids) + "_CloseBy_Object_" + std::to_string(idt) + "ieqe");
-			break;
-		case AlignWith:
-			switch (g[*ei].align_edge)
-			{
-			case 0:
-				model.addConstr(y_i[ids] - w_i[ids] / 2 == y_i[idt] - w_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			case 1:
-				model.addConstr(x_i[ids] + l_i[ids] / 2 == x_i[idt] + l_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			case 2:
-				model.addConstr(y_i[ids] + w_i[ids] / 2 == y_i[idt] + w_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			case 3:
-				model.addConstr(x_i[ids] - l_i[ids] / 2 == x_i[idt] - l_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			case 4:
-				model.addConstr(z_i[ids] - h_i[ids] / 2 == z_i[idt] + h_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			case 5:
-				model.addConstr(z_i[ids] + h_i[ids] / 2 == z_i[idt] - h_i[idt] / 2, "Object_" + std::to_string(ids) + "_AlignWith_Object_" + std::to_string(idt));
-				break;
-			default:break;
+		ModelBuilder::Constr row;
+		if (relationRow(g[*ei], ids, idt, boxVars, row)) {
+			addConstr(row, { ConstraintKind::Relation, ids, idt, g[*ei].type });
+			continue;
+		}
+		if (g[*ei].type != CloseBy)
+			continue;
+		// Side binaries in row order R, L, F, B; a chosen side keeps the two boxes touching on that side
+		ModelBuilder::Var sides[4] = { builder.addVar(0, 1, GRB_BINARY), builder.addVar(0, 1, GRB_BINARY),
+			builder.addVar(0, 1, GRB_BINARY), builder.addVar(0, 1, GRB_BINARY) };
+		ModelBuilder::Constr rows[4] = {
+			xv[ids] - lv[ids] / 2 <= xv[idt] + lv[idt] / 2,
+			xv[ids] + lv[ids] / 2 >= xv[idt] - lv[idt] / 2,
+			yv[ids] - wv[ids] / 2 <= yv[idt] + wv[idt] / 2,
+			yv[ids] + wv[ids] / 2 >= yv[idt] - wv[idt] / 2 };
+		for (int k = 0; k < 4; ++k) {
+			if (disjunctionMode == DisjunctionMode::Indicator) {
+				addIndicator(sides[k], rows[k], { ConstraintKind::CloseBy, ids, idt, k });
+				continue;
 			}
-			break;
-		default:break;
+			// Row k is violated by at most the largest gap the objects can have on side k
+			double M = std::max(0.0, ranges[ids].maxGap(ranges[idt], k));
+			ModelBuilder::Expr relax = M * (1 - sides[k]);
+			rows[k].expr -= rows[k].sense == GRB_LESS_EQUAL ? relax : -relax;
+			addConstr(rows[k], { ConstraintKind::CloseBy, ids, idt, k });
 		}
+		addConstr(sides[0] + sides[1] + sides[2] + sides[3] <= 1, { ConstraintKind::CloseBy, ids, idt, 4 });
 	}
 	// Non overlap Constraints
-	auto vi_start_end = boost::vertices(g);
-	VertexIterator vj;
-	for (vi = vi_start_end.first; vi != vi_start_end.second; ++vi) {
-		for (vj = vi_start_end.first; vj != vi_start_end.second; ++vj) {
-			if (g[*vi].id < g[*vj].id && !has_path(g, *vi, *vj) && !has_path(g, *vj, *vi)) {
-				sigma_R[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-				sigma_L[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-				sigma_F[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-				sigma_B[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 >= x_i[g[*vj].id] + l_i[g[*vj].id] / 2 -
-					M * (1 - sigma_R[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "R");
-				model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 <= x_i[g[*vj].id] - l_i[g[*vj].id] / 2 +
-					M * (1 - sigma_L[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "L");
-				model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 >= y_i[g[*vj].id] + w_i[g[*vj].id] / 2 - 
-					M * (1 - sigma_F[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "F");
-				model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 <= y_i[g[*vj].id] - w_i[g[*vj].id] / 2 + 
-					M * (1 - sigma_B[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "B");
-
-				if (!floorplan) {
-					sigma_U[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-					sigma_D[g[*vi].id][g[*vj].id] = model.addVar(0, 1, 0, GRB_BINARY);
-					model.addConstr(z_i[g[*vi].id] - h_i[g[*vi].id] / 2 >= z_i[g[*vj].id] + h_i[g[*vj].id] / 2 -
-						M * (1 - sigma_U[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "U");
-					model.addConstr(z_i[g[*vi].id] + h_i[g[*vi].id] / 2 <= z_i[g[*vj].id] - h_i[g[*vj].id] / 2 +
-						M * (1 - sigma_D[g[*vi].id][g[*vj].id]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id) + "D");
-					model.addConstr(sigma_L[g[*vi].id][g[*vj].id] + sigma_R[g[*vi].id][g[*vj].id] +
-						sigma_F[g[*vi].id][g[*vj].id] + sigma_B[g[*vi].id][g[*vj].id] +
-						sigma_U[g[*vi].id][g[*vj].id] + sigma_D[g[*vi].id][g[*vj].id] >= 1, "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id));
-				}
-				else {
-					model.addConstr(sigma_L[g[*vi].id][g[*vj].id] + sigma_R[g[*vi].id][g[*vj].id] +
-						sigma_F[g[*vi].id][g[*vj].id] + sigma_B[g[*vi].id][g[*vj].id] >= 1, "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Object_" + std::to_string(g[*vj].id));
-				}
-			}
-		}
+	// Only pairs without a directional path get a disjunction. With pruneDisjunctions the pairs come from a
+	// sweep over the reachable boxes, so pairs that can never touch are skipped without being enumerated.
+	auto boxOf = [&](int id) -> std::array<ModelBuilder::Expr, 6> {
+		return { xv[id], yv[id], zv[id], lv[id], wv[id], hv[id] };
+	};
+	std::vector<std::pair<int, int>> candidates;
+	if (pruneDisjunctions) {
+		std::vector<AABB> bounds(num_vertices);
+		for (int i = 0; i < num_vertices; ++i)
+			bounds[i] = ranges[i].bounds();
+		sweepAndPrune(bounds, dims, [&](int i, int j) { candidates.push_back({ i, j }); });
+		std::sort(candidates.begin(), candidates.end());
+	}
+	else {
+		for (int i = 0; i < num_vertices; ++i)
+			for (int j = i + 1; j < num_vertices; ++j)
+				candidates.push_back({ i, j });
+	}
+	stats.candidatePairs = candidates.size();
+	{
+		PhaseTimer timer(stats.pairFilterTime);
+		buildReachability();
+		candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+			[&](const std::pair<int, int>& p) { return has_path(p.first, p.second) || has_path(p.second, p.first); }), candidates.end());
+	}
+	for (const auto& [i, j] : candidates) {
+		unsigned sides = pruneDisjunctions ? feasibleSides(ranges[i], ranges[j]) : allSides();
+		// Interchangeable objects are ordered by x, so the lower id is never strictly right of the higher one
+		if (breakSymmetry && symmetryClassOf[i] >= 0 && symmetryClassOf[i] == symmetryClassOf[j] && (sides & ~(1u << SideRight)))
+			sides &= ~(1u << SideRight);
+		if (sides == 0)
+			continue;
+		if (lazyNonOverlap && backend == MipBackendType::Gurobi)
+			nonOverlapPairs.push_back(addLazyDisjunction(i, j, ranges[i], ranges[j], sides));
+		else
+			nonOverlapPairs.push_back(addDisjunction(ConstraintKind::NonOverlap, i, j, boxOf(i), boxOf(j), ranges[i], ranges[j], sides));
 	}
 	// Obstacle Constraints
+	// With pruneDisjunctions a grid over the obstacles yields the ones an object can reach, the others need no rows
+	std::vector<BoxRange> obstacleRanges(num_obstacles);
+	std::vector<AABB> obstacleBounds(num_obstacles);
+	for (int i = 0; i < num_obstacles; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			obstacleRanges[i].cmin[k] = obstacleRanges[i].cmax[k] = obstacles[i].pos[k];
+			obstacleRanges[i].smin[k] = obstacleRanges[i].smax[k] = obstacles[i].size[k];
+		}
+		obstacleBounds[i] = obstacleRanges[i].bounds();
+	}
+	BoxGrid obstacleGrid(obstacleBounds, dims);
+	std::vector<int> nearby(num_obstacles);
 	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-		for (int i = 0; i < num_obstacles; ++i) {
-			GRBLinExpr sigma_o = 0;
-			sigma_oL[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-			model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 <= obstacles[i].pos[0] - obstacles[i].size[0] / 2 +
-				M * (1 - sigma_oL[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "L");
-			sigma_o += sigma_oL[g[*vi].id][i];
-
-			sigma_oR[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-			model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 >= obstacles[i].pos[0] + obstacles[i].size[0] / 2 -
-				M * (1 - sigma_oR[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "R");
-			sigma_o += sigma_oR[g[*vi].id][i];
-
-			sigma_oB[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-			model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 <= obstacles[i].pos[1] - obstacles[i].size[1] / 2 +
-				M * (1 - sigma_oB[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "B");	
-			sigma_o += sigma_oB[g[*vi].id][i];
-			sigma_oF[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-
-			model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 >= obstacles[i].pos[1] + obstacles[i].size[1] / 2 -
-				M * (1 - sigma_oF[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "F");
-			sigma_o += sigma_oF[g[*vi].id][i];
-
-			if (!floorplan) {
-				sigma_oD[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(z_i[g[*vi].id] + h_i[g[*vi].id] / 2 <= obstacles[i].pos[2] - obstacles[i].size[2] / 2 +
-					M * (1 - sigma_oD[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "D");
-				sigma_o += sigma_oD[g[*vi].id][i];
-
-				sigma_oU[g[*vi].id][i] = model.addVar(0, 1, 0, GRB_BINARY);
-				model.addConstr(z_i[g[*vi].id] - h_i[g[*vi].id] / 2 >= obstacles[i].pos[2] + obstacles[i].size[2] / 2 -
-					M * (1 - sigma_oU[g[*vi].id][i]), "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i) + "U");
-				sigma_o += sigma_oU[g[*vi].id][i];
-			}
-			model.addConstr(sigma_o >= 1, "NonOverlap_Object_" + std::to_string(g[*vi].id) + "and_Obstacle_" + std::to_string(i));	
+		int id = g[*vi].id;
+		if (pruneDisjunctions)
+			obstacleGrid.query(ranges[id].bounds(), nearby);
+		else
+			std::iota(nearby.begin(), nearby.end(), 0);
+		for (int i : nearby) {
+			unsigned sides = pruneDisjunctions ? feasibleSides(ranges[id], obstacleRanges[i]) : allSides();
+			if (sides == 0)
+				continue;
+			std::array<ModelBuilder::Expr, 6> obstacle = { obstacles[i].pos[0], obstacles[i].pos[1], obstacles[i].pos[2],
+				obstacles[i].size[0], obstacles[i].size[1], obstacles[i].size[2] };
+			obstaclePairs.push_back(addDisjunction(ConstraintKind::Obstacle, id, i, boxOf(id), obstacle, ranges[id], obstacleRanges[i], sides));
 		}
 	}
 	// Boundary Constraints
 	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-		if (g[*vi].boundary >= 0) {
-			double x1 = boundary.points[g[*vi].boundary][0], x2 = boundary.points[(g[*vi].boundary + 1) % boundary.Orientations.size()][0];
-			double y1 = boundary.points[g[*vi].boundary][1], y2 = boundary.points[(g[*vi].boundary + 1) % boundary.Orientations.size()][1];
-			double x1_ = std::min(x1, x2), x2_ = std::max(x1, x2);
-			double y1_ = std::min(y1, y2), y2_ = std::max(y1, y2);
-			switch (boundary.Orientations[g[*vi].boundary])
-			{
-			case LEFT:
-				model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 == x1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Left_eq");
-				// Here we assume that on boundary means at least half of length is on the wall
-				model.addConstr(y_i[g[*vi].id] >= y1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Left_ieq");
-				model.addConstr(y_i[g[*vi].id] <= y2_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Left_ieqq");
-				break;
-			case RIGHT:
-				model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 == x1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Right_eq");
-				model.addConstr(y_i[g[*vi].id] >= y1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Right_ieq");
-				model.addConstr(y_i[g[*vi].id] <= y2_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Right_ieqq");
-				break;
-			case FRONT:
-				model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 == y1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Front_eq");
-				model.addConstr(x_i[g[*vi].id] >= x1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Front_ieq");
-				model.addConstr(x_i[g[*vi].id] <= x2_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Front_ieqq");
-				break;
-			case BACK:
-				model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 == y1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Back_eq");
-				model.addConstr(x_i[g[*vi].id] >= x1_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Back_ieq");
-				model.addConstr(x_i[g[*vi].id] <= x2_, "Boundary_Object_" + std::to_string(g[*vi].id) + "_Back_ieqq");
-				break;
-			default:break;
-			}
+		ModelBuilder::Constr rows[3];
+		if (!wallRows(g[*vi], boxVars[g[*vi].id], rows))
+			continue;
+		for (int part = 0; part < 3; ++part)
+			addConstr(rows[part], { ConstraintKind::Boundary, g[*vi].id, boundary.Orientations[g[*vi].boundary], part });
+	}
+	// Corner Constraints
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		// The chosen corner point is a convex combination of binaries, sx/sy pick the matching box edges
+		const std::vector<int>* corners = nullptr;
+		double sx = 0, sy = 0;
+		switch (g[*vi].corner)
+		{
+			case BOTTOMLEFT: corners = &boundary.BLcorner; sx = -1; sy = -1; break;
+			case BOTTOMRIGHT: corners = &boundary.BRcorner; sx = 1; sy = -1; break;
+			case TOPLEFT: corners = &boundary.TLcorner; sx = -1; sy = 1; break;
+			case TOPRIGHT: corners = &boundary.TRcorner; sx = 1; sy = 1; break;
+			default: break;
 		}
+		if (!corners)
+			continue;
+		int id = g[*vi].id, num = corners->size();
+		std::vector<ModelBuilder::Var> cor(num);
+		for (int i = 0; i < num; ++i)
+			cor[i] = builder.addVar(0.0, 1.0, GRB_BINARY);
+		builder.beginRow();
+		for (int i = 0; i < num; ++i)
+			builder.addTerm(cor[i], 1);
+		addRow(GRB_EQUAL, 1, { ConstraintKind::Corner, id, g[*vi].corner, 0 });
+		builder.beginRow();
+		builder.addTerm(xv[id], 1);
+		builder.addTerm(lv[id], sx / 2);
+		for (int i = 0; i < num; ++i)
+			builder.addTerm(cor[i], -boundary.points[(*corners)[i]][0]);
+		addRow(GRB_EQUAL, 0, { ConstraintKind::Corner, id, g[*vi].corner, 1 });
+		builder.beginRow();
+		builder.addTerm(yv[id], 1);
+		builder.addTerm(wv[id], sy / 2);
+		for (int i = 0; i < num; ++i)
+			builder.addTerm(cor[i], -boundary.points[(*corners)[i]][1]);
+		addRow(GRB_EQUAL, 0, { ConstraintKind::Corner, id, g[*vi].corner, 2 });
 	}
+
+	// Linear objective: e >= error and e >= -error for every error term, areas through McCormick rows
+	errorVars.clear();
+	areaVars.assign(num_vertices, ModelBuilder::Var());
+	if (modelObjective == ObjectiveMode::Linear) {
+		std::vector<ObjectiveTerm> terms;
+		std::vector<int> area_ids;
+		std::array<int, 4> counts;
+		collectObjective(boxVars, terms, area_ids, counts);
+		for (size_t k = 0; k < terms.size(); ++k) {
+			ModelBuilder::Var e = builder.addVar(0, GRB_INFINITY, GRB_CONTINUOUS);
+			addConstr(ModelBuilder::Expr(e) >= terms[k].error, { ConstraintKind::ObjectiveError, (int)k, -1, 0 });
+			addConstr(ModelBuilder::Expr(e) >= -terms[k].error, { ConstraintKind::ObjectiveError, (int)k, -1, 1 });
+			errorVars.push_back(e);
+		}
+		for (int id : area_ids)
+			areaVars[id] = addAreaVar(id, ranges[id]);
+	}
+
 	// Floor Plan Constraints :AREA
 	if (floorplan)
 	{
-		GRBQuadExpr total_area = 0;
+		std::vector<ModelBuilder::Var> lengths, widths;
 		double unuse_area = boundary.size[0] * boundary.size[1];
 		for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-			total_area += l_i[g[*vi].id] * w_i[g[*vi].id];
+			lengths.push_back(lv[g[*vi].id]);
+			widths.push_back(wv[g[*vi].id]);
 		}
 		for (int i = 0; i < num_obstacles; ++i) {
 			unuse_area -= obstacles[i].size[0] * obstacles[i].size[1];
 		}
-		model.addQConstr(total_area == unuse_area, "Area_Constraint_for_FloorPlan");
+		if (modelObjective == ObjectiveMode::Linear) {
+			builder.beginRow();
+			for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+				int id = g[*vi].id;
+				if (!areaVars[id].valid())
+					areaVars[id] = addAreaVar(id, ranges[id]);
+				builder.addTerm(areaVars[id], 1);
+			}
+			addRow(GRB_EQUAL, unuse_area, { ConstraintKind::Area, -1, -1, 6 });
+		}
+		else
+			builder.addQuadConstr(lengths, widths, std::vector<double>(lengths.size(), 1.0), GRB_EQUAL, unuse_area, "Area_Constraint_for_FloorPlan");
 	}
-	// Corner Constraints
-	std::vector<std::vector<GRBVar>> cor(num_vertices);
-	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-		switch (g[*vi].corner)
+
+	// Push everything staged above to the model in bulk; the other backends read the staged model itself
+	if (backend == MipBackendType::Gurobi) {
+		std::vector<std::string> rowNames, indicatorNames;
+		if (nameConstraints) {
+			rowNames.reserve(constraintTags.size());
+			for (const ConstraintTag& tag : constraintTags)
+				rowNames.push_back(constraintName(tag));
+			for (const ConstraintTag& tag : indicatorTags)
+				indicatorNames.push_back(constraintName(tag));
+		}
+		builder.flush(*model, rowNames, indicatorNames, vars, constraints, indicatorConstraints);
+		for (int i = 0; i < num_vertices; ++i) {
+			x_i[i] = modelVar(xv[i].index); y_i[i] = modelVar(yv[i].index); z_i[i] = modelVar(zv[i].index);
+			l_i[i] = modelVar(lv[i].index); w_i[i] = modelVar(wv[i].index); h_i[i] = modelVar(hv[i].index);
+		}
+		builder.clear();
+	}
+	buildObjective();
+}
+
+bool Solver::relationRow(const EdgeProperties& ep, int ids, int idt, const std::vector<std::array<ModelBuilder::Var, 6>>& box,
+	ModelBuilder::Constr& row) const
+{
+	const std::array<ModelBuilder::Var, 6>& s = box[ids];
+	const std::array<ModelBuilder::Var, 6>& t = box[idt];
+	// A negative distance asks for contact instead of an ordering
+	bool contact = ep.distance < 0;
+	switch (ep.type)
+	{
+	case LeftOf:
+		row = contact ? (s[0] + s[3] / 2 == t[0] - t[3] / 2) : (s[0] + s[3] / 2 <= t[0] - t[3] / 2);
+		return true;
+	case RightOf:
+		row = contact ? (s[0] - s[3] / 2 == t[0] + t[3] / 2) : (s[0] - s[3] / 2 >= t[0] + t[3] / 2);
+		return true;
+	case Behind:
+		row = contact ? (s[1] + s[4] / 2 == t[1] - t[4] / 2) : (s[1] + s[4] / 2 <= t[1] - t[4] / 2);
+		return true;
+	case FrontOf:
+		row = contact ? (s[1] - s[4] / 2 == t[1] + t[4] / 2) : (s[1] - s[4] / 2 >= t[1] + t[4] / 2);
+		return true;
+	case Under:
+		row = s[2] + s[5] / 2 == t[2] - t[5] / 2;
+		return true;
+	case Above:
+		row = s[2] - s[5] / 2 == t[2] + t[5] / 2;
+		return true;
+	case AlignWith:
+		switch (ep.align_edge)
 		{
-			case BOTTOMLEFT:
-			{
-				int num = boundary.BLcorner.size();
-				cor[g[*vi].id].resize(num);
-				GRBLinExpr posx, posy, cors;
-				for (int i = 0; i < num; ++i) {
-					cor[g[*vi].id][i] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
-					posx += boundary.points[boundary.BLcorner[i]][0] * cor[g[*vi].id][i];
-					posy += boundary.points[boundary.BLcorner[i]][1] * cor[g[*vi].id][i];
-					cors += cor[g[*vi].id][i];
-				}
-				model.addConstr(cors == 1, "BottomLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqa");
-				model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 == posx, "BottomLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqb");
-				model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 == posy, "BottomLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqc");
+		case 0: row = s[1] - s[4] / 2 == t[1] - t[4] / 2; return true;
+		case 1: row = s[0] + s[3] / 2 == t[0] + t[3] / 2; return true;
+		case 2: row = s[1] + s[4] / 2 == t[1] + t[4] / 2; return true;
+		case 3: row = s[0] - s[3] / 2 == t[0] - t[3] / 2; return true;
+		case 4: row = s[2] - s[5] / 2 == t[2] + t[5] / 2; return true;
+		case 5: row = s[2] + s[5] / 2 == t[2] - t[5] / 2; return true;
+		default: return false;
+		}
+	default:
+		return false;
+	}
+}
+
+bool Solver::wallRows(const VertexProperties& vp, const std::array<ModelBuilder::Var, 6>& box, ModelBuilder::Constr rows[3]) const
+{
+	if (vp.boundary < 0)
+		return false;
+	double x1 = boundary.points[vp.boundary][0], x2 = boundary.points[(vp.boundary + 1) % boundary.Orientations.size()][0];
+	double y1 = boundary.points[vp.boundary][1], y2 = boundary.points[(vp.boundary + 1) % boundary.Orientations.size()][1];
+	double x1_ = std::min(x1, x2), x2_ = std::max(x1, x2);
+	double y1_ = std::min(y1, y2), y2_ = std::max(y1, y2);
+	ModelBuilder::Expr x = box[0], y = box[1], l = box[3], w = box[4];
+	switch (boundary.Orientations[vp.boundary])
+	{
+	case LEFT:
+		rows[0] = x - l / 2 == x1_;
+		// Here we assume that on boundary means at least half of length is on the wall
+		rows[1] = y >= y1_;
+		rows[2] = y <= y2_;
+		return true;
+	case RIGHT:
+		rows[0] = x + l / 2 == x1_;
+		rows[1] = y >= y1_;
+		rows[2] = y <= y2_;
+		return true;
+	case FRONT:
+		rows[0] = y + w / 2 == y1_;
+		rows[1] = x >= x1_;
+		rows[2] = x <= x2_;
+		return true;
+	case BACK:
+		rows[0] = y - w / 2 == y1_;
+		rows[1] = x >= x1_;
+		rows[2] = x <= x2_;
+		return true;
+	default:
+		return false;
+	}
+}
+
+unsigned Solver::allSides() const
+{
+	return floorplan ? 0x0f : 0x3f;
+}
+
+unsigned Solver::feasibleSides(const BoxRange& a, const BoxRange& b) const
+{
+	// Apart on some axis for every placement: the pair needs no disjunction at all
+	int dims = floorplan ? 2 : 3;
+	AABB ba = a.bounds(), bb = b.bounds();
+	for (int k = 0; k < dims; ++k)
+		if (ba.hi[k] <= bb.lo[k] || bb.hi[k] <= ba.lo[k])
+			return 0;
+	unsigned sides = 0;
+	for (int side = 0; side < 2 * dims; ++side)
+		if (a.canBeOnSide(b, side))
+			sides |= 1u << side;
+	// No side is reachable: keep the full disjunction so that the IIS can report the pair
+	return sides ? sides : allSides();
+}
+
+BoxRange Solver::objectRange(const VertexProperties& vp) const
+{
+	BoxRange range;
+	for (int k = 0; k < 3; ++k) {
+		range.smin[k] = 0;
+		range.smax[k] = boundary.size[k];
+		if (!vp.target_size.empty() && !vp.size_tolerance.empty()) {
+			range.smin[k] = std::max(0.0, vp.target_size[k] - vp.size_tolerance[k]);
+			range.smax[k] = std::min(boundary.size[k], vp.target_size[k] + vp.size_tolerance[k]);
+		}
+		range.cmin[k] = boundary.origin_pos[k] + range.smin[k] / 2;
+		range.cmax[k] = boundary.origin_pos[k] + boundary.size[k] - range.smin[k] / 2;
+		if (!vp.target_pos.empty() && !vp.pos_tolerance.empty()) {
+			range.cmin[k] = std::max(range.cmin[k], vp.target_pos[k] - vp.pos_tolerance[k]);
+			range.cmax[k] = std::min(range.cmax[k], vp.target_pos[k] + vp.pos_tolerance[k]);
+		}
+	}
+	return range;
+}
+
+DisjunctionPair Solver::addDisjunction(ConstraintKind kind, int first, int second, const std::array<ModelBuilder::Expr, 6>& a,
+	const std::array<ModelBuilder::Expr, 6>& b, const BoxRange& ra, const BoxRange& rb, unsigned sides)
+{
+	// Constraint parts follow the side order for objects and L, R, B, F, D, U for obstacles
+	static const int obstacle_parts[6] = { 1, 0, 3, 2, 5, 4 };
+	DisjunctionPair pair = { first, second, { -1, -1, -1, -1, -1, -1 } };
+	if (sides == 0)
+		return pair;
+	// With a single reachable side the binary is fixed to 1 and the row is added without big-M
+	bool fixed = (sides & (sides - 1)) == 0;
+	ModelBuilder::Expr sum;
+	for (int side = 0; side < 6; ++side) {
+		if (!(sides & (1u << side)))
+			continue;
+		int k = side / 2, part = kind == ConstraintKind::Obstacle ? obstacle_parts[side] : side;
+		ModelBuilder::Constr row = side % 2 == 0 ? (a[k] - a[k + 3] / 2 >= b[k] + b[k + 3] / 2) : (a[k] + a[k + 3] / 2 <= b[k] - b[k + 3] / 2);
+		if (fixed) {
+			addConstr(row, { kind, first, second, part });
+			continue;
+		}
+		ModelBuilder::Var sigma = builder.addVar(0, 1, GRB_BINARY);
+		pair.sigma[side] = sigma.index;
+		sum += sigma;
+		if (disjunctionMode == DisjunctionMode::Indicator) {
+			addIndicator(sigma, row, { kind, first, second, part });
+			continue;
+		}
+		// Smallest M that relaxes the row for every reachable placement of the two boxes
+		double M = std::max(0.0, ra.maxOverlap(rb, side));
+		ModelBuilder::Expr relax = M * (1 - sigma);
+		row.expr += side % 2 == 0 ? relax : -relax;
+		addConstr(row, { kind, first, second, part });
+	}
+	if (!fixed)
+		addConstr(sum >= 1, { kind, first, second, 6 });
+	return pair;
+}
+
+void Solver::collectObjective(const std::vector<std::array<ModelBuilder::Var, 6>>& box, std::vector<ObjectiveTerm>& terms,
+	std::vector<int>& area_ids, std::array<int, 4>& counts) const
+{
+	VertexIterator vi, vi_end;
+	EdgeIterator ei, ei_end;
+	auto X = [&](int id) { return ModelBuilder::Expr(box[id][0]); };
+	auto Y = [&](int id) { return ModelBuilder::Expr(box[id][1]); };
+	auto Z = [&](int id) { return ModelBuilder::Expr(box[id][2]); };
+	auto L = [&](int id) { return ModelBuilder::Expr(box[id][3]); };
+	auto W = [&](int id) { return ModelBuilder::Expr(box[id][4]); };
+	auto H = [&](int id) { return ModelBuilder::Expr(box[id][5]); };
+	// Notice that hyperparameters are the weights of area, size error, position error, adjacency error.
+	counts = { 0, 0, 0, 0 };
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		int id = g[*vi].id;
+		bool area_flag = true;
+		boost::graph_traits<SceneGraph>::out_edge_iterator e_out, e_end;
+		for (boost::tie(e_out, e_end) = boost::out_edges(*vi, g); e_out != e_end; ++e_out) {
+			if (g[*e_out].type == Above || g[*e_out].type == Under) {
+				area_flag = false;
 				break;
 			}
-			case BOTTOMRIGHT:
+		}
+		if (area_flag)
+			area_ids.push_back(id);
+		if (!g[*vi].target_size.empty()) {
+			terms.push_back({ L(id) - g[*vi].target_size[0], 1, boundary.size[0] });
+			terms.push_back({ W(id) - g[*vi].target_size[1], 1, boundary.size[1] });
+			if (!floorplan)
+				terms.push_back({ H(id) - g[*vi].target_size[2], 1, boundary.size[2] });
+			counts[1]++;
+		}
+		if (!g[*vi].target_pos.empty()) {
+			terms.push_back({ X(id) - g[*vi].target_pos[0], 2, boundary.size[0] });
+			terms.push_back({ Y(id) - g[*vi].target_pos[1], 2, boundary.size[1] });
+			if (!floorplan)
+				terms.push_back({ Z(id) - g[*vi].target_pos[2], 2, boundary.size[2] });
+			counts[2]++;
+		}
+	}
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+		int s = g[boost::source(*ei, g)].id;
+		int t = g[boost::target(*ei, g)].id;
+		std::vector<double> offset = g[*ei].xyoffset;
+		if (offset.empty())
+			offset = { 0, 0 };
+		if (g[*ei].distance >= 0) {
+			double d = g[*ei].distance;
+			switch (g[*ei].type)
 			{
-				int num = boundary.BRcorner.size();
-				cor[g[*vi].id].resize(num);
-				GRBLinExpr posx, posy, cors;
-				for (int i = 0; i < num; ++i) {
-					cor[g[*vi].id][i] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
-					posx += boundary.points[boundary.BRcorner[i]][0] * cor[g[*vi].id][i];
-					posy += boundary.points[boundary.BRcorner[i]][1] * cor[g[*vi].id][i];
-					cors += cor[g[*vi].id][i];
-				}
-				model.addConstr(cors == 1, "BottomRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqa");
-				model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 == posx, "BottomRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqb");
-				model.addConstr(y_i[g[*vi].id] - w_i[g[*vi].id] / 2 == posy, "BottomRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqc");
+			case LeftOf:
+				terms.push_back({ X(t) - L(t) / 2 - X(s) - L(s) / 2 - d, 3, boundary.size[0] });
+				counts[3]++;
 				break;
-			}
-			case TOPLEFT:
-			{
-				int num = boundary.TLcorner.size();
-				cor[g[*vi].id].resize(num);
-				GRBLinExpr posx, posy, cors;
-				for (int i = 0; i < num; ++i) {
-					cor[g[*vi].id][i] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
-					posx += boundary.points[boundary.TLcorner[i]][0] * cor[g[*vi].id][i];
-					posy += boundary.points[boundary.TLcorner[i]][1] * cor[g[*vi].id][i];
-					cors += cor[g[*vi].id][i];
-				}
-				model.addConstr(cors == 1, "TopLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqa");
-				model.addConstr(x_i[g[*vi].id] - l_i[g[*vi].id] / 2 == posx, "TopLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqb");
-				model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 == posy, "TopLeft_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqc");
+			case RightOf:
+				terms.push_back({ X(s) - L(s) / 2 - X(t) - L(t) / 2 - d, 3, boundary.size[0] });
+				counts[3]++;
 				break;
-			}
-			case TOPRIGHT:
-			{
-				int num = boundary.TRcorner.size();
-				cor[g[*vi].id].resize(num);
-				GRBLinExpr posx, posy, cors;
-				for (int i = 0; i < num; ++i) {
-					cor[g[*vi].id][i] = model.addVar(0.0, 1.0, 0.0, GRB_BINARY);
-					posx += boundary.points[boundary.TRcorner[i]][0] * cor[g[*vi].id][i];
-					posy += boundary.points[boundary.TRcorner[i]][1] * cor[g[*vi].id][i];
-					cors += cor[g[*vi].id][i];
-				}
-				model.addConstr(cors == 1, "TopRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqa");
-				model.addConstr(x_i[g[*vi].id] + l_i[g[*vi].id] / 2 == posx, "TopRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqb");
-				model.addConstr(y_i[g[*vi].id] + w_i[g[*vi].id] / 2 == posy, "TopRight_Corner_of_Object_" + std::to_string(g[*vi].id) + "eqc");
+			case Behind:
+				terms.push_back({ Y(t) - W(t) / 2 - Y(s) - W(s) / 2 - d, 3, boundary.size[1] });
+				counts[3]++;
 				break;
+			case FrontOf:
+				terms.push_back({ Y(s) - W(s) / 2 - Y(t) - W(t) / 2 - d, 3, boundary.size[1] });
+				counts[3]++;
+				break;
+			default:break;
 			}
+		}
+		if (g[*ei].type == Above || g[*ei].type == Under || g[*ei].type == CloseBy) {
+			terms.push_back({ X(s) - X(t) - offset[0], 3, boundary.size[0] });
+			terms.push_back({ Y(s) - Y(t) - offset[1], 3, boundary.size[1] });
+			counts[3]++;
+		}
+	}
+}
+
+ModelBuilder::Var Solver::addAreaVar(int id, const BoxRange& range)
+{
+	// The size tolerance rows keep l and w inside the range, tighter than the variable bounds
+	ModelBuilder::Var l = boxVars[id][3], w = boxVars[id][4];
+	double l_min = std::max(builder.lowerBound(l), range.smin[0]), l_max = std::min(builder.upperBound(l), range.smax[0]);
+	double w_min = std::max(builder.lowerBound(w), range.smin[1]), w_max = std::min(builder.upperBound(w), range.smax[1]);
+	ModelBuilder::Var a = builder.addVar(l_min * w_min, l_max * w_max, GRB_CONTINUOUS);
+	ModelBuilder::Expr A(a), L(l), W(w);
+	// McCormick envelope of l * w for l in [lo, hi]; when on (the segment binary) is valid, only if on is 1
+	auto envelope = [&](ModelBuilder::Var on, int segment, double lo, double hi) {
+		ModelBuilder::Constr rows[] = {
+			A <= hi * W + w_min * L - hi * w_min, A <= lo * W + w_max * L - lo * w_max,
+			A >= lo * W + w_min * L - lo * w_min, A >= hi * W + w_max * L - hi * w_max,
+			L >= lo, L <= hi
+		};
+		for (int part = 0; part < (on.valid() ? 6 : 4); ++part) {
+			if (on.valid())
+				addIndicator(on, rows[part], { ConstraintKind::Area, id, segment, part });
+			else
+				addConstr(rows[part], { ConstraintKind::Area, id, segment, part });
+		}
+	};
+	int segments = l_max - l_min > 1e-6 ? std::max(areaSegments, 1) : 1;
+	if (segments == 1) {
+		envelope(ModelBuilder::Var(), -1, l_min, l_max);
+		return a;
+	}
+	// One binary per length segment, the envelope of the chosen segment is much tighter than the full one
+	std::vector<ModelBuilder::Var> on(segments);
+	for (int k = 0; k < segments; ++k)
+		on[k] = builder.addVar(0, 1, GRB_BINARY);
+	builder.beginRow();
+	for (int k = 0; k < segments; ++k)
+		builder.addTerm(on[k], 1);
+	addRow(GRB_EQUAL, 1, { ConstraintKind::Area, id, -1, 6 });
+	double step = (l_max - l_min) / segments;
+	for (int k = 0; k < segments; ++k)
+		envelope(on[k], k, l_min + k * step, k + 1 == segments ? l_max : l_min + (k + 1) * step);
+	return a;
+}
+
+DisjunctionPair Solver::addLazyDisjunction(int first, int second, const BoxRange& ra, const BoxRange& rb, unsigned sides)
+{
+	LazyDisjunction lazy = { { first, second, { -1, -1, -1, -1, -1, -1 } }, sides, { 0, 0, 0, 0, 0, 0 }, 0 };
+	// As in addDisjunction, a single reachable side needs neither a binary nor a big-M
+	bool fixed = (sides & (sides - 1)) == 0;
+	for (int side = 0; side < 6; ++side) {
+		if (!(sides & (1u << side)) || fixed)
+			continue;
+		lazy.pair.sigma[side] = builder.addVar(0, 1, GRB_BINARY).index;
+		lazy.M[side] = std::max(0.0, ra.maxOverlap(rb, side));
+	}
+	lazyPairs.push_back(lazy);
+	return lazy.pair;
+}
+
+void Solver::lazyDisjunctionRows(const LazyDisjunction& lazy, std::vector<ModelBuilder::Constr>& rows, std::vector<ConstraintTag>& tags) const
+{
+	const std::array<ModelBuilder::Var, 6>& a = boxVars[lazy.pair.first];
+	const std::array<ModelBuilder::Var, 6>& b = boxVars[lazy.pair.second];
+	ModelBuilder::Expr sum;
+	bool fixed = true;
+	for (int side = 0; side < 6; ++side) {
+		if (!(lazy.sides & (1u << side)))
+			continue;
+		int k = side / 2;
+		ModelBuilder::Constr row = side % 2 == 0 ? (a[k] - ModelBuilder::Expr(a[k + 3]) / 2 >= b[k] + ModelBuilder::Expr(b[k + 3]) / 2) :
+			(a[k] + ModelBuilder::Expr(a[k + 3]) / 2 <= b[k] - ModelBuilder::Expr(b[k + 3]) / 2);
+		int sigma = lazy.pair.sigma[side];
+		if (sigma >= 0) {
+			fixed = false;
+			ModelBuilder::Var var;
+			var.index = sigma;
+			ModelBuilder::Expr relax = lazy.M[side] * (1 - ModelBuilder::Expr(var));
+			row.expr += side % 2 == 0 ? relax : -relax;
+			sum += var;
+		}
+		rows.push_back(row);
+		tags.push_back({ ConstraintKind::NonOverlap, lazy.pair.first, lazy.pair.second, side });
+	}
+	if (!fixed) {
+		rows.push_back(sum >= 1);
+		tags.push_back({ ConstraintKind::NonOverlap, lazy.pair.first, lazy.pair.second, 6 });
+	}
+}
+
+void Solver::separateOverlaps(const std::vector<double>& values, std::vector<ModelBuilder::Constr>& rows)
+{
+	std::vector<ConstraintTag> tags;
+	for (LazyDisjunction& lazy : lazyPairs) {
+		if (lazy.state != 0)
+			continue;
+		const std::array<ModelBuilder::Var, 6>& a = boxVars[lazy.pair.first];
+		const std::array<ModelBuilder::Var, 6>& b = boxVars[lazy.pair.second];
+		// The boxes overlap when every side of the disjunction is violated by more than the feasibility tolerance
+		bool overlap = true;
+		for (int side = 0; side < 6 && overlap; ++side) {
+			if (!(lazy.sides & (1u << side)))
+				continue;
+			int k = side / 2;
+			double gap = values[a[k].index] - values[b[k].index];
+			if (side % 2 != 0)
+				gap = -gap;
+			overlap = gap - (values[a[k + 3].index] + values[b[k + 3].index]) / 2 < -1e-5;
+		}
+		if (!overlap)
+			continue;
+		lazyDisjunctionRows(lazy, rows, tags);
+		lazy.state = 1;
+		stats.lazyPairs++;
+	}
+}
+
+void Solver::commitLazyRows()
+{
+	std::vector<ModelBuilder::Constr> rows;
+	std::vector<ConstraintTag> tags;
+	for (LazyDisjunction& lazy : lazyPairs) {
+		if (lazy.state != 1)
+			continue;
+		lazyDisjunctionRows(lazy, rows, tags);
+		lazy.state = 2;
+	}
+	for (size_t i = 0; i < rows.size(); ++i) {
+		constraints.push_back(model->addConstr(linExpr(rows[i].expr), rows[i].sense, 0, nameConstraints ? constraintName(tags[i]) : ""));
+		constraintTags.push_back(tags[i]);
+	}
+	if (!rows.empty())
+		model->update();
+}
+
+GRBLinExpr Solver::linExpr(const ModelBuilder::Expr& e) const
+{
+	GRBLinExpr result = e.constant;
+	for (int k = 0; k < e.size; ++k)
+		result += e.coeffs[k] * vars[e.vars[k]];
+	return result;
+}
+
+void Solver::buildObjective()
+{
+	std::vector<ObjectiveTerm> terms;
+	std::vector<int> area_ids;
+	std::array<int, 4> counts;
+	collectObjective(boxVars, terms, area_ids, counts);
+	// Objective Function
+	builder.clearObjective();
+	builder.addObjective(hyperparameters[0]);
+	double area_weight = -hyperparameters[0] / boundary.size[0] / boundary.size[1];
+	// Terms without any contributing object/edge stay zero (e.g. an edgeless cluster of a decomposed solve)
+	if (modelObjective == ObjectiveMode::Linear) {
+		for (int id : area_ids)
+			builder.addObjective(area_weight * ModelBuilder::Expr(areaVars[id]));
+		for (size_t k = 0; k < terms.size(); ++k) {
+			const ObjectiveTerm& term = terms[k];
+			builder.addObjective(hyperparameters[term.weight] / term.scale / std::max(counts[term.weight], 1) * ModelBuilder::Expr(errorVars[k]));
+		}
+	}
+	else {
+		for (int id : area_ids)
+			builder.addObjectiveProduct(boxVars[id][3], boxVars[id][4], area_weight);
+		for (const ObjectiveTerm& term : terms)
+			builder.addObjectiveSquare(term.error, hyperparameters[term.weight] / term.scale / term.scale / std::max(counts[term.weight], 1));
+	}
+	if (backend == MipBackendType::Gurobi)
+		builder.flushObjective(*model, vars);
+}
+
+std::vector<double> Solver::hintBox(const VertexProperties& vp) const
+{
+	const std::vector<double>& pos = !vp.pos.empty() ? vp.pos : vp.target_pos;
+	const std::vector<double>& size = !vp.size.empty() ? vp.size : vp.target_size;
+	if (pos.size() < 3 || size.size() < 3)
+		return {};
+	int dims = floorplan ? 2 : 3;
+	std::vector<double> box(6);
+	for (int k = 0; k < dims; ++k) {
+		double s = std::min(size[k], boundary.size[k]);
+		if (!vp.size_tolerance.empty() && !vp.target_size.empty())
+			s = std::clamp(s, vp.target_size[k] - vp.size_tolerance[k], vp.target_size[k] + vp.size_tolerance[k]);
+		double p = pos[k];
+		if (!vp.pos_tolerance.empty() && !vp.target_pos.empty())
+			p = std::clamp(p, vp.target_pos[k] - vp.pos_tolerance[k], vp.target_pos[k] + vp.pos_tolerance[k]);
+		p = std::clamp(p, boundary.origin_pos[k] + s / 2, std::max(boundary.origin_pos[k] + s / 2, boundary.origin_pos[k] + boundary.size[k] - s / 2));
+		box[k] = p;
+		box[k + 3] = s;
+	}
+	return box;
+}
+
+LayoutProblem Solver::layoutProblem() const
+{
+	int num_vertices = boost::num_vertices(g);
+	LayoutProblem problem;
+	problem.dims = floorplan ? 2 : 3;
+	for (int k = 0; k < 3; ++k) {
+		problem.room.lo[k] = boundary.origin_pos[k];
+		problem.room.hi[k] = boundary.origin_pos[k] + boundary.size[k];
+	}
+	if (floorplan)
+		problem.room.lo[2] = problem.room.hi[2] = 0;
+	// Box handles of the flat coordinates 6 * id + k, the rows and errors below are the ones of addConstraints
+	std::vector<std::array<ModelBuilder::Var, 6>> box(num_vertices);
+	for (int i = 0; i < num_vertices; ++i)
+		for (int k = 0; k < 6; ++k)
+			box[i][k].index = 6 * i + k;
+	problem.ranges.resize(num_vertices);
+	problem.support.assign(num_vertices, -1);
+	problem.corners.resize(num_vertices);
+	problem.cornerSides.resize(num_vertices);
+	problem.hints.resize(num_vertices);
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		const VertexProperties& vp = g[*vi];
+		problem.ranges[vp.id] = objectRange(vp);
+		problem.hints[vp.id] = hintBox(vp);
+		if (!floorplan && vp.on_floor)
+			problem.support[vp.id] = 0;
+		else if (!floorplan && vp.hanging)
+			problem.support[vp.id] = 1;
+		ModelBuilder::Constr rows[3];
+		if (wallRows(vp, box[vp.id], rows))
+			problem.rows.insert(problem.rows.end(), rows, rows + 3);
+		const std::vector<int>* corners = nullptr;
+		double sx = 0, sy = 0;
+		switch (vp.corner)
+		{
+			case BOTTOMLEFT: corners = &boundary.BLcorner; sx = -1; sy = -1; break;
+			case BOTTOMRIGHT: corners = &boundary.BRcorner; sx = 1; sy = -1; break;
+			case TOPLEFT: corners = &boundary.TLcorner; sx = -1; sy = 1; break;
+			case TOPRIGHT: corners = &boundary.TRcorner; sx = 1; sy = 1; break;
 			default: break;
 		}
+		if (!corners)
+			continue;
+		for (int c : *corners)
+			problem.corners[vp.id].push_back({ boundary.points[c][0], boundary.points[c][1] });
+		problem.cornerSides[vp.id] = { sx, sy };
+	}
+	// CloseBy has no row of its own, its closeness is part of the objective
+	EdgeIterator ei, ei_end;
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+		ModelBuilder::Constr row;
+		if (relationRow(g[*ei], g[boost::source(*ei, g)].id, g[boost::target(*ei, g)].id, box, row))
+			problem.rows.push_back(row);
+	}
+	for (const Obstacles& o : obstacles) {
+		AABB bounds;
+		for (int k = 0; k < 3; ++k) {
+			bounds.lo[k] = o.pos[k] - o.size[k] / 2;
+			bounds.hi[k] = o.pos[k] + o.size[k] / 2;
+		}
+		problem.obstacles.push_back(bounds);
+	}
+	// Same weights as the quadratic objective of buildObjective, without its constant hyperparameters[0]
+	std::vector<ObjectiveTerm> terms;
+	std::array<int, 4> counts;
+	collectObjective(box, terms, problem.areaIds, counts);
+	for (const ObjectiveTerm& term : terms) {
+		problem.errors.push_back(term.error);
+		problem.errorWeights.push_back(hyperparameters[term.weight] / term.scale / term.scale / std::max(counts[term.weight], 1));
+	}
+	problem.areaWeight = -hyperparameters[0] / boundary.size[0] / boundary.size[1];
+	if (floorplan) {
+		problem.totalArea = boundary.size[0] * boundary.size[1];
+		for (const Obstacles& o : obstacles)
+			problem.totalArea -= o.size[0] * o.size[1];
+	}
+	return problem;
+}
+
+HeuristicResult Solver::runHeuristic()
+{
+	PhaseTimer timer(stats.heuristicTime);
+	HeuristicSettings settings;
+	settings.timeLimit = heuristicTimeLimit;
+	HeuristicResult result = solveLayoutHeuristic(layoutProblem(), settings);
+	if (verbose)
+		std::cout << "Heuristic layout: violation " << result.violation << ", objective " << result.objective
+			<< " after " << result.iterations << " iterations" << std::endl;
+	return result;
+}
+
+void Solver::storeHeuristic(const HeuristicResult& result)
+{
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		const std::array<double, 6>& b = result.boxes[g[*vi].id];
+		g[*vi].pos = { b[0], b[1], b[2] };
+		g[*vi].size = { b[3], b[4], b[5] };
+		if (floorplan) {
+			g[*vi].pos[2] = g[*vi].target_size[2] / 2;
+			g[*vi].size[2] = g[*vi].target_size[2];
+		}
+	}
+	stats.heuristic = true;
+	stats.objective = hyperparameters[0] + result.objective;
+}
+
+void Solver::heuristicFallbackSolve()
+{
+	if (!heuristicFallback || stats.solCount > 0 || !graphProcessor.conflict_info.empty() || cancelled())
+		return;
+	HeuristicResult result = runHeuristic();
+	if (!result.feasible())
+		return;
+	if (verbose)
+		std::cout << "No MIP solution, keeping the heuristic layout" << std::endl;
+	storeHeuristic(result);
+}
+
+void Solver::setWarmStart(const std::vector<std::vector<double>>& start)
+{
+	// Hint box per object id: x, y, z, l, w, h, clamped into the boundary and the tolerance ranges
+	int num_vertices = boost::num_vertices(g);
+	int dims = floorplan ? 2 : 3;
+	std::vector<std::vector<double>> hint(num_vertices);
+	std::vector<GRBVar> startVars;
+	std::vector<double> startValues;
+	VertexIterator vi, vi_end;
+	auto given = [&](int id) { return id < (int)start.size() && !start[id].empty(); };
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		int id = g[*vi].id;
+		if (given(id)) {
+			VertexProperties vp = g[*vi];
+			vp.pos.assign(start[id].begin(), start[id].begin() + 3);
+			vp.size.assign(start[id].begin() + 3, start[id].end());
+			hint[id] = hintBox(vp);
+		}
+		else
+			hint[id] = hintBox(g[*vi]);
+	}
+	// Objects that were never solved start from the heuristic layout instead of their targets
+	if (heuristicStart) {
+		HeuristicResult result = runHeuristic();
+		if (result.feasible()) {
+			for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi)
+				if (g[*vi].pos.empty() && !given(g[*vi].id))
+					hint[g[*vi].id].assign(result.boxes[g[*vi].id].begin(), result.boxes[g[*vi].id].end());
+		}
+	}
+	// Keep the hints of interchangeable objects consistent with their x ordering
+	if (breakSymmetry) {
+		for (const std::vector<int>& members : symmetryClasses) {
+			std::vector<std::vector<double>> boxes;
+			for (int id : members)
+				if (!hint[id].empty())
+					boxes.push_back(hint[id]);
+			if (boxes.size() != members.size())
+				continue;
+			std::sort(boxes.begin(), boxes.end());
+			for (size_t k = 0; k < members.size(); ++k)
+				hint[members[k]] = boxes[k];
+		}
+	}
+	for (int id = 0; id < num_vertices; ++id) {
+		if (hint[id].empty())
+			continue;
+		const GRBVar* box_vars[6] = { &x_i[id], &y_i[id], &z_i[id], &l_i[id], &w_i[id], &h_i[id] };
+		for (int k = 0; k < 6; ++k) {
+			if (k % 3 < dims) {
+				startVars.push_back(*box_vars[k]);
+				startValues.push_back(hint[id][k]);
+			}
+		}
+	}
+
+	// A disjunction binary starts at 1 when its side is separated in the hint boxes. Pairs that overlap in
+	// the hints are left undefined so that Gurobi completes them.
+	auto push_sides = [&](const DisjunctionPair& pair, const std::vector<double>& a, const std::vector<double>& b) {
+		// Separations indexed by DisjunctionSide: a right of b, a left of b, a in front of b, a behind b, a above b, a below b
+		bool sides[6];
+		for (int k = 0; k < 3; ++k) {
+			sides[2 * k] = a[k] - a[k + 3] / 2 >= b[k] + b[k + 3] / 2;
+			sides[2 * k + 1] = a[k] + a[k + 3] / 2 <= b[k] - b[k + 3] / 2;
+		}
+		bool separated = false;
+		for (int k = 0; k < 6; ++k)
+			separated = separated || (pair.sigma[k] >= 0 && sides[k]);
+		if (!separated)
+			return;
+		for (int k = 0; k < 6; ++k) {
+			if (pair.sigma[k] < 0)
+				continue;
+			startVars.push_back(vars[pair.sigma[k]]);
+			startValues.push_back(sides[k] ? 1 : 0);
+		}
+	};
+	for (const DisjunctionPair& pair : nonOverlapPairs)
+		if (!hint[pair.first].empty() && !hint[pair.second].empty())
+			push_sides(pair, hint[pair.first], hint[pair.second]);
+	for (const DisjunctionPair& pair : obstaclePairs) {
+		if (hint[pair.first].empty())
+			continue;
+		const Obstacles& o = obstacles[pair.second];
+		push_sides(pair, hint[pair.first], { o.pos[0], o.pos[1], o.pos[2], o.size[0], o.size[1], o.size[2] });
+	}
+	if (!startVars.empty())
+		model->set(GRB_DoubleAttr_Start, startVars.data(), startValues.data(), startVars.size());
+}
+
+void Solver::setParameters(GRBModel& target) const
+{
+	target.set(GRB_IntParam_OutputFlag, verbose ? 1 : 0);
+	target.set(GRB_IntParam_Threads, threads);
+	target.set(GRB_DoubleParam_TimeLimit, remainingTime());
+	if (floorplan)
+		target.set(GRB_DoubleParam_MIPGap, 0.11);
+	else
+		target.set(GRB_DoubleParam_MIPGap, 0.01);
+	target.set(GRB_IntParam_MIPFocus, 1);
+	target.set(GRB_IntParam_Method, 2);
+	target.set(GRB_DoubleParam_BarConvTol, 1e-4);
+	target.set(GRB_IntParam_Cuts, 2);
+	target.set(GRB_IntParam_Presolve, 0);
+	if (!lazyPairs.empty())
+		target.set(GRB_IntParam_LazyConstraints, 1);
+}
+
+double Solver::remainingTime() const
+{
+	return std::max(0.0, timeLimit - secondsSince(solveStart));
+}
+
+void Solver::storeSolution()
+{
+	double* values = model->get(GRB_DoubleAttr_X, vars.data(), vars.size());
+	std::vector<double> solution(values, values + vars.size());
+	delete[] values;
+	storeSolution(solution, model->get(GRB_DoubleAttr_ObjVal));
+}
+
+void Solver::storeSolution(const std::vector<double>& values, double objective)
+{
+	if (verbose) {
+		for (size_t i = 0; i < vars.size(); ++i)
+			std::cout << "Variable " << vars[i].get(GRB_StringAttr_VarName) << ": Value = " << values[i] << std::endl;
+	}
+	writeBoxes(g, values);
+	// Keep the whole incumbent for the MIP start of the next resolve()
+	lastSolution = values;
+	if (verbose)
+		std::cout << "Value of objective function: " << objective << std::endl;
+}
+
+void Solver::writeBoxes(SceneGraph& graph, const std::vector<double>& values) const
+{
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(graph); vi != vi_end; ++vi) {
+		int id = graph[*vi].id;
+		const std::array<ModelBuilder::Var, 6>& box = boxVars[id];
+		graph[*vi].pos = { values[box[0].index], values[box[1].index], 0 };
+		graph[*vi].size = { values[box[3].index], values[box[4].index], 0 };
+		if (!floorplan) {
+			graph[*vi].pos[2] = values[box[2].index];
+			graph[*vi].size[2] = values[box[5].index];
+		}
+		else {
+			graph[*vi].pos[2] = graph[*vi].target_size[2] / 2;
+			graph[*vi].size[2] = graph[*vi].target_size[2];
+		}
+	}
+}
+
+void Solver::beginIncumbentStream(bool append)
+{
+	if (!solveCallback)
+		solveCallback = std::make_unique<SolveCallback>(*this);
+	model->setCallback(solveCallback.get());
+	std::lock_guard<std::mutex> lock(incumbentMutex);
+	incumbent.graph = g;
+	incumbentCount = 0;
+	progress = SolveProgress();
+	if (!append && incumbentStream.is_open())
+		incumbentStream.close();
+	if (streamIncumbents && !incumbentStreamPath.empty() && !incumbentStream.is_open()) {
+		incumbentStream.open(incumbentStreamPath, append ? std::ios::app : std::ios::trunc);
+		if (!incumbentStream.is_open())
+			std::cerr << "Failed to open incumbent stream for writing: " << incumbentStreamPath << std::endl;
+	}
+}
+
+void Solver::publishIncumbent(const std::vector<double>& values, double objective, double bound, double runtime)
+{
+	std::lock_guard<std::mutex> lock(incumbentMutex);
+	progress.runtime = std::max(progress.runtime, runtime);
+	progress.solutions++;
+	progress.objective = std::min(progress.objective, objective);
+	progress.bound = std::max(progress.bound, bound);
+	if (!streamIncumbents || (incumbentCount > 0 && objective >= incumbent.objective))
+		return;
+	writeBoxes(incumbent.graph, values);
+	incumbent.objective = objective;
+	incumbent.bound = bound;
+	incumbent.runtime = runtime;
+	incumbent.version++;
+	incumbentCount++;
+	if (!incumbentStream.is_open())
+		return;
+	nlohmann::json line = { { "solution", incumbentCount }, { "time", runtime }, { "objective", objective }, { "bound", bound } };
+	line["vertices"] = nlohmann::json::array();
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(incumbent.graph); vi != vi_end; ++vi) {
+		const VertexProperties& vp = incumbent.graph[*vi];
+		line["vertices"].push_back({ { "id", vp.id }, { "position", vp.pos }, { "size", vp.size } });
+	}
+	incumbentStream << line.dump() << std::endl;
+}
+
+void Solver::publishProgress(double runtime, double objective, double bound, double nodes, int solutions)
+{
+	std::lock_guard<std::mutex> lock(incumbentMutex);
+	progress.runtime = runtime;
+	progress.objective = objective;
+	progress.bound = bound;
+	progress.nodes = nodes;
+	progress.solutions = solutions;
+}
+
+SolveProgress Solver::getprogress()
+{
+	std::lock_guard<std::mutex> lock(incumbentMutex);
+	return progress;
+}
+
+void Solver::cancel()
+{
+	*cancelFlag = true;
+}
+
+bool Solver::getincumbent(IncumbentSnapshot& snapshot)
+{
+	std::lock_guard<std::mutex> lock(incumbentMutex);
+	if (incumbent.version <= snapshot.version)
+		return false;
+	snapshot = incumbent;
+	return true;
+}
+
+void Solver::recordResult(GRBModel& optimized)
+{
+	stats.status = optimized.get(GRB_IntAttr_Status);
+	stats.solCount = optimized.get(GRB_IntAttr_SolCount);
+	stats.runtime = optimized.get(GRB_DoubleAttr_Runtime);
+	// Node count and gap only exist for MIPs, a scene without any binary is a plain QP
+	bool mip = optimized.get(GRB_IntAttr_IsMIP);
+	stats.nodeCount = mip ? optimized.get(GRB_DoubleAttr_NodeCount) : 0;
+	stats.mipGap = -1;
+	stats.objective = -1;
+	if (stats.solCount > 0) {
+		stats.mipGap = mip ? optimized.get(GRB_DoubleAttr_MIPGap) : 0;
+		stats.objective = optimized.get(GRB_DoubleAttr_ObjVal);
 	}
-	
-	
-	// Objective Function
-	// Notice that hyperparameters are the weights of area, size error, position error, adjacency error.
-	GRBQuadExpr obj1 = hyperparameters[0], obj2 = 0, obj3 = 0, obj4 = 0;
-	int num2 = 0, num3 = 0, num4 = 0;
-	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
-		bool area_flag = true;
-		boost::graph_traits<SceneGraph>::out_edge_iterator e_out, e_end;
-		for (boost::tie(e_out, e_end) = boost::out_edges(*vi, g); e_out != e_end; ++e_out) {
-			if (g[*e_out].type == Above || g[*e_out].type == Under) {
-				area_flag = false;
-				break;
-			}
+}
+
+namespace {
+
+// Best incumbent of the racing portfolio models, vars in model order
+struct PortfolioShared {
+	std::mutex mutex;
+	std::vector<double> best;
+	double bestObj = GRB_INFINITY;
+	int version = 0;
+	std::atomic<bool> done{ false };
+};
+
+// Stops a portfolio model once another one has finished and exchanges incumbents between them:
+// new solutions are published at MIPSOL, better ones from the other models are injected at MIPNODE
+class PortfolioCallback : public GRBCallback {
+public:
+	// publish receives every incumbent that improves the shared one, it may be empty
+	PortfolioCallback(PortfolioShared& shared, const std::atomic<bool>& cancelled, const GRBVar* vars, int numVars,
+		std::function<void(const std::vector<double>&, double, double, double)> publish)
+		: shared(shared), cancelled(cancelled), vars(vars), numVars(numVars), publish(std::move(publish)) {}
+
+protected:
+	void callback() override
+	{
+		if (shared.done || cancelled) {
+			abort();
+			return;
 		}
-		if (area_flag)
-			obj1 -= hyperparameters[0] * l_i[g[*vi].id] * w_i[g[*vi].id] / boundary.size[0] / boundary.size[1];
-		if (!g[*vi].target_size.empty()) {
-			obj2 += hyperparameters[1] * (l_i[g[*vi].id] - g[*vi].target_size[0]) * (l_i[g[*vi].id] - g[*vi].target_size[0]) / boundary.size[0] / boundary.size[0];
-			obj2 += hyperparameters[1] * (w_i[g[*vi].id] - g[*vi].target_size[1]) * (w_i[g[*vi].id] - g[*vi].target_size[1]) / boundary.size[1] / boundary.size[1];
-			if (!floorplan)
-				obj2 += hyperparameters[1] * (h_i[g[*vi].id] - g[*vi].target_size[2]) * (h_i[g[*vi].id] - g[*vi].target_size[2]) / boundary.size[2] / boundary.size[2];
-			num2++;
+		if (where == GRB_CB_MIPSOL) {
+			double obj = getDoubleInfo(GRB_CB_MIPSOL_OBJ);
+			std::lock_guard<std::mutex> lock(shared.mutex);
+			if (obj >= shared.bestObj)
+				return;
+			double* values = getSolution(vars, numVars);
+			shared.best.assign(values, values + numVars);
+			delete[] values;
+			shared.bestObj = obj;
+			seen = ++shared.version;
+			if (publish)
+				publish(shared.best, obj, getDoubleInfo(GRB_CB_MIPSOL_OBJBND), getDoubleInfo(GRB_CB_RUNTIME));
 		}
-		if (!g[*vi].target_pos.empty()) {
-			obj3 += hyperparameters[2] * (x_i[g[*vi].id] - g[*vi].target_pos[0]) * (x_i[g[*vi].id] - g[*vi].target_pos[0]) / boundary.size[0] / boundary.size[0];
-			obj3 += hyperparameters[2] * (y_i[g[*vi].id] - g[*vi].target_pos[1]) * (y_i[g[*vi].id] - g[*vi].target_pos[1]) / boundary.size[1] / boundary.size[1];
-			if (!floorplan)
-				obj3 += hyperparameters[2] * (z_i[g[*vi].id] - g[*vi].target_pos[2]) * (z_i[g[*vi].id] - g[*vi].target_pos[2]) / boundary.size[2] / boundary.size[2];
-			num3++;
+		else if (where == GRB_CB_MIPNODE && getIntInfo(GRB_CB_MIPNODE_STATUS) == GRB_OPTIMAL) {
+			std::lock_guard<std::mutex> lock(shared.mutex);
+			if (seen == shared.version)
+				return;
+			seen = shared.version;
+			if (shared.bestObj < getDoubleInfo(GRB_CB_MIPNODE_OBJBST))
+				setSolution(vars, shared.best.data(), numVars);
 		}
 	}
-	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
-		VertexDescriptor source = boost::source(*ei, g);
-		VertexDescriptor target = boost::target(*ei, g);
-		std::vector<double> offset = g[*ei].xyoffset;
-		if (offset.empty())
-			offset = { 0, 0 };
-		if (g[*ei].distance >= 0) {
-			switch (g[*ei].type)
-			{
-			case LeftOf:
-				obj4 += hyperparameters[3] * (x_i[g[target].id] - l_i[g[target].id] / 2 - x_i[g[source].id] - l_i[g[source].id] / 2 - g[*ei].distance) *
-					(x_i[g[target].id] - l_i[g[target].id] / 2 - x_i[g[source].id] - l_i[g[source].id] / 2 - g[*ei].distance) / boundary.size[0] / boundary.size[0];
-				num4++;
-				break;
-			case RightOf:
-				obj4 += hyperparameters[3] * (x_i[g[source].id] - l_i[g[source].id] / 2 - x_i[g[target].id] - l_i[g[target].id] / 2 - g[*ei].distance) *
-					(x_i[g[source].id] - l_i[g[source].id] / 2 - x_i[g[target].id] - l_i[g[target].id] / 2 - g[*ei].distance) / boundary.size[0] / boundary.size[0];
-				num4++;
-				break;
-			case Behind:
-				obj4 += hyperparameters[3] * (y_i[g[target].id] - w_i[g[target].id] / 2 - y_i[g[source].id] - w_i[g[source].id] / 2 - g[*ei].distance) *
-					(y_i[g[target].id] - w_i[g[target].id] / 2 - y_i[g[source].id] - w_i[g[source].id] / 2 - g[*ei].distance) / boundary.size[1] / boundary.size[1];
-				num4++;
-				break;
-			case FrontOf:
-				obj4 += hyperparameters[3] * (y_i[g[source].id] - w_i[g[source].id] / 2 - y_i[g[target].id] - w_i[g[target].id] / 2 - g[*ei].distance) *
-					(y_i[g[source].id] - w_i[g[source].id] / 2 - y_i[g[target].id] - w_i[g[target].id] / 2 - g[*ei].distance) / boundary.size[1] / boundary.size[1];
-				num4++;
-				break;
-			default:break;
+
+private:
+	PortfolioShared& shared;
+	const std::atomic<bool>& cancelled;
+	const GRBVar* vars;
+	int numVars;
+	std::function<void(const std::vector<double>&, double, double, double)> publish;
+	int seen = 0;
+};
+
+// Configuration 0 keeps setParameters as is, the others trade its feasibility focus for the defaults, for
+// proving optimality or for the bound; configurations beyond four repeat them with another seed
+void setPortfolioConfig(GRBModel& target, int config)
+{
+	target.set(GRB_IntParam_Seed, config);
+	switch (config % 4)
+	{
+	case 1:
+		target.set(GRB_IntParam_MIPFocus, 0);
+		target.set(GRB_IntParam_Method, -1);
+		target.set(GRB_IntParam_Cuts, -1);
+		target.set(GRB_IntParam_Presolve, -1);
+		break;
+	case 2:
+		target.set(GRB_IntParam_MIPFocus, 2);
+		target.set(GRB_IntParam_Cuts, 1);
+		target.set(GRB_IntParam_Presolve, 1);
+		break;
+	case 3:
+		target.set(GRB_IntParam_MIPFocus, 3);
+		target.set(GRB_IntParam_Method, 1);
+		target.set(GRB_IntParam_Cuts, 3);
+		target.set(GRB_IntParam_Presolve, 2);
+		break;
+	default: break;
+	}
+}
+
+}
+
+bool Solver::racePortfolio()
+{
+	int num_configs = portfolio;
+	int workers = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+	// Every racer gets a copy of the model, including the MIP start, in an environment of its own
+	model->update();
+	double* start = model->get(GRB_DoubleAttr_Start, vars.data(), vars.size());
+	std::vector<double> starts(start, start + vars.size());
+	delete[] start;
+
+	// The copies are made here, reading the source model from several threads at once is not safe
+	std::vector<std::unique_ptr<GRBEnv>> racerEnvs;
+	std::vector<std::unique_ptr<GRBModel>> racers;
+	try {
+		for (int config = 0; config < num_configs; ++config) {
+			racerEnvs.push_back(std::make_unique<GRBEnv>(true));
+			racerEnvs.back()->set(GRB_IntParam_OutputFlag, 0);
+			racerEnvs.back()->start();
+			racers.push_back(std::make_unique<GRBModel>(*model, *racerEnvs.back()));
+		}
+	}
+	catch (GRBException& e) {
+		std::cout << "Error code = " << e.getErrorCode() << std::endl;
+		std::cout << e.getMessage() << std::endl;
+		return false;
+	}
+
+	PortfolioShared shared;
+	std::atomic<int> winner{ -1 };
+	std::vector<std::vector<double>> solutions(num_configs);
+	std::vector<double> objectives(num_configs, GRB_INFINITY);
+	std::vector<int> status(num_configs, GRB_LOADED);
+	auto race = [&](int config) {
+		GRBModel& racer = *racers[config];
+		GRBVar* racerVars = nullptr;
+		try {
+			racerVars = racer.getVars();
+			racer.set(GRB_DoubleAttr_Start, racerVars, starts.data(), vars.size());
+			setParameters(racer);
+			racer.set(GRB_IntParam_OutputFlag, 0);
+			racer.set(GRB_IntParam_Threads, std::max(1, workers / num_configs));
+			setPortfolioConfig(racer, config);
+			auto publish = [this](const std::vector<double>& values, double objective, double bound, double runtime) {
+				publishIncumbent(values, objective, bound, runtime);
+			};
+			PortfolioCallback callback(shared, *cancelFlag, racerVars, vars.size(), publish);
+			racer.setCallback(&callback);
+			racer.optimize();
+			status[config] = racer.get(GRB_IntAttr_Status);
+			if (racer.get(GRB_IntAttr_SolCount) > 0) {
+				double* values = racer.get(GRB_DoubleAttr_X, racerVars, vars.size());
+				solutions[config].assign(values, values + vars.size());
+				delete[] values;
+				objectives[config] = racer.get(GRB_DoubleAttr_ObjVal);
+			}
+			// Reaching the gap or proving infeasibility settles the race for every configuration
+			if (status[config] == GRB_OPTIMAL || status[config] == GRB_INFEASIBLE) {
+				int none = -1;
+				winner.compare_exchange_strong(none, config);
+				shared.done = true;
 			}
 		}
-		if (g[*ei].type == Above || g[*ei].type == Under || g[*ei].type == CloseBy) {
-			obj4 += hyperparameters[3] * (x_i[g[source].id] - x_i[g[target].id] - offset[0]) * (x_i[g[source].id] - x_i[g[target].id] - offset[0]) / boundary.size[0] / boundary.size[0];
-			obj4 += hyperparameters[3] * (y_i[g[source].id] - y_i[g[target].id] - offset[1]) * (y_i[g[source].id] - y_i[g[target].id] - offset[1]) / boundary.size[1] / boundary.size[1];
-			num4++;
+		catch (GRBException& e) {
+			std::cout << "Portfolio configuration " << config << ": error code = " << e.getErrorCode() << ", " << e.getMessage() << std::endl;
 		}
+		delete[] racerVars;
+	};
+	std::vector<std::thread> pool;
+	for (int config = 0; config < num_configs; ++config)
+		pool.emplace_back(race, config);
+	for (std::thread& t : pool)
+		t.join();
+
+	// Without a configuration that reached the gap (time limit) the best incumbent is taken
+	int chosen = winner;
+	if (chosen < 0)
+		chosen = std::min_element(objectives.begin(), objectives.end()) - objectives.begin();
+	if (solutions[chosen].empty()) {
+		// Infeasible or no incumbent at all: the regular path runs the IIS handling on the model itself
+		if (verbose)
+			std::cout << "Portfolio found no solution, solving the model directly" << std::endl;
+		return false;
 	}
-	model.setObjective(obj1 + obj2 / num2 + obj3 / num3 + obj4 / num4, GRB_MINIMIZE);
+	if (verbose)
+		std::cout << "Portfolio configuration " << chosen << " won" << (winner < 0 ? " (time limit)" : "") << std::endl;
+	recordResult(*racers[chosen]);
+	storeSolution(solutions[chosen], objectives[chosen]);
+	return true;
 }
 
 void Solver::optimizeModel()
 {
     try {
-        model.set(GRB_DoubleParam_TimeLimit, 10);
-		if (floorplan)
-        	model.set(GRB_DoubleParam_MIPGap, 0.11);
-		else
-			model.set(GRB_DoubleParam_MIPGap, 0.01);
-		model.set(GRB_IntParam_MIPFocus, 1);
-        model.set(GRB_IntParam_Method, 2);
-        model.set(GRB_DoubleParam_BarConvTol, 1e-4);
-        model.set(GRB_IntParam_Cuts, 2);
-        model.set(GRB_IntParam_Presolve, 0);
-        model.optimize();
-		int iter = 0;
-        while (model.get(GRB_IntAttr_Status) == GRB_INFEASIBLE && iter < 3) {
-            //model.computeIIS();
-            //model.write("model.ilp");
-            //std::cout << "Infeasible constraints written to 'model.ilp'" << std::endl;
-			std::cout << "Model is infeasible. Calling IIS computation..." << std::endl;
-            handleInfeasibleModel();
-			iter++;
-        }
-
-		if (graphProcessor.conflict_info.empty()) {
-			GRBVar* vars = model.getVars();
-        	int numVars = model.get(GRB_IntAttr_NumVars);
-        	for (auto i = 0; i < numVars; ++i) {
-        	    std::string varName = vars[i].get(GRB_StringAttr_VarName);
-        	    double varValue = vars[i].get(GRB_DoubleAttr_X);
-        	    std::cout << "Variable " << varName << ": Value = " << varValue << std::endl;
-        	}
-        	VertexIterator vi1, vi_end1;
-			for (boost::tie(vi1, vi_end1) = boost::vertices(g); vi1 != vi_end1; ++vi1) {
-        	    g[*vi1].pos = { 0, 0, 0 };
-        	    g[*vi1].size = { 0, 0, 0 };
-				std::string varName = "x_" + std::to_string(g[*vi1].id);
-				double varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-				g[*vi1].pos[0] = varValue;
-
-				varName = "y_" + std::to_string(g[*vi1].id);
-				varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-				g[*vi1].pos[1] = varValue;
-
-				varName = "l_" + std::to_string(g[*vi1].id);
-				varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-				g[*vi1].size[0] = varValue;
-
-				varName = "w_" + std::to_string(g[*vi1].id);
-				varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-				g[*vi1].size[1] = varValue;
-
-        	    if (!floorplan) {
-        	        varName = "z_" + std::to_string(g[*vi1].id);
-        	        varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-        	        g[*vi1].pos[2] = varValue;
-
-        	        varName = "h_" + std::to_string(g[*vi1].id);
-        	        varValue = model.getVarByName(varName).get(GRB_DoubleAttr_X);
-        	        g[*vi1].size[2] = varValue;
-        	    }
-        	    else {
-					g[*vi1].pos[2] = g[*vi1].target_size[2] / 2;
-					g[*vi1].size[2] = g[*vi1].target_size[2];
-        	    }
-        	}
-        	std::cout << "Value of objective function: " << model.get(GRB_DoubleAttr_ObjVal) << std::endl;
+		// The portfolio falls back to the single solve below when none of its configurations found a solution
+		bool raced = false;
+		{
+			PhaseTimer timer(stats.optimizeTime);
+			// The racers have no callback to add the lazy rows
+			raced = portfolio > 1 && lazyPairs.empty() && racePortfolio();
+			if (!raced) {
+				setParameters(*model);
+				model->optimize();
+				commitLazyRows();
+			}
+		}
+		if (!raced) {
+			int iter = 0;
+			while (model->get(GRB_IntAttr_Status) == GRB_INFEASIBLE && iter < 3 && !cancelled() && graphProcessor.conflict_info.empty()) {
+				//model->computeIIS();
+				//model->write("model.ilp");
+				//std::cout << "Infeasible constraints written to 'model.ilp'" << std::endl;
+				std::cout << "Model is infeasible. Calling IIS computation..." << std::endl;
+				handleInfeasibleModel();
+				iter++;
+			}
+			recordResult(*model);
+			// A cancelled or timed out solve may end without any solution
+			if (graphProcessor.conflict_info.empty() && stats.solCount > 0)
+				storeSolution();
 		}
     }
     catch (GRBException e) {
@@ -536,7 +1653,9 @@ void Solver::optimizeModel()
     catch (...) {
         std::cout << "Exception during optimization" << std::endl;
     }
-	
+	heuristicFallbackSolve();
+	if (!verbose)
+		return;
 
     VertexIterator vi, vi_end;
     for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
@@ -555,24 +1674,410 @@ void Solver::optimizeModel()
     }
 }
 
+void Solver::solveWithBackend()
+{
+	std::unique_ptr<MipBackend> mip = makeHighsBackend();
+	if (!mip) {
+		std::cerr << "This build has no HiGHS support, use the Gurobi backend" << std::endl;
+		heuristicFallbackSolve();
+		return;
+	}
+	MipSettings settings;
+	settings.threads = threads;
+	settings.timeLimit = remainingTime();
+	settings.mipGap = floorplan ? 0.11 : 0.01;
+	settings.verbose = verbose;
+	MipResult result;
+	try {
+		PhaseTimer timer(stats.optimizeTime);
+		result = mip->solve(builder, settings, {});
+	}
+	catch (const std::exception& e) {
+		std::cerr << mip->name() << ": " << e.what() << std::endl;
+		heuristicFallbackSolve();
+		return;
+	}
+	stats.status = result.status;
+	stats.solCount = result.solCount;
+	stats.runtime = result.runtime;
+	stats.nodeCount = result.nodeCount;
+	stats.mipGap = result.solCount > 0 ? result.mipGap : -1;
+	stats.objective = result.solCount > 0 ? result.objective : -1;
+	if ((result.status == GRB_INFEASIBLE || result.status == GRB_INF_OR_UNBD) && !(iisPrecheck && screenInfeasibility())) {
+		graphProcessor.conflict_info = "Model is infeasible. " + mip->name() + " computes no IIS, solve with Gurobi to locate the conflicting constraints.";
+		graphProcessor.plan_info.clear();
+	}
+	else if (result.solCount > 0)
+		storeSolution(result.values, result.objective);
+	heuristicFallbackSolve();
+}
+
+void Solver::configureSubSolver(Solver& sub) const
+{
+	sub.floorplan = floorplan;
+	sub.hyperparameters = hyperparameters;
+	sub.verbose = false;
+	sub.saveDebugFiles = false;
+	sub.nameConstraints = false;
+	sub.threads = threads;
+	sub.warmStart = warmStart;
+	// The sub-solver gets what is left of this solve, callers hand out a share of it
+	sub.timeLimit = remainingTime();
+	sub.solveStart = std::chrono::steady_clock::now();
+	sub.pruneDisjunctions = pruneDisjunctions;
+	sub.disjunctionMode = disjunctionMode;
+	sub.breakSymmetry = breakSymmetry;
+	sub.objectiveMode = objectiveMode;
+	sub.modelObjective = modelObjective;
+	sub.areaSegments = areaSegments;
+	sub.heuristicStart = heuristicStart;
+	sub.heuristicFallback = false;
+	sub.heuristicTimeLimit = heuristicTimeLimit;
+	sub.boundary = boundary;
+	sub.obstacles = obstacles;
+	sub.cancelFlag = cancelFlag;
+}
+
+void Solver::watchSubSolver(Solver& sub)
+{
+	sub.solveCallback = std::make_unique<SolveCallback>(sub, *this);
+	sub.model->setCallback(sub.solveCallback.get());
+}
+
+bool Solver::solveCoarseToFine()
+{
+	// Coarse level: the rooms before splitGraph2, one box per room and far fewer disjunctions
+	int num_rooms = boost::num_vertices(roomGraph);
+	if (num_rooms == 0 || (int)boost::num_vertices(g) != 2 * num_rooms)
+		return false;
+	std::vector<std::vector<double>> rooms(num_rooms);
+	try {
+		Solver coarse;
+		configureSubSolver(coarse);
+		// The coarse model gets a third of the budget, the fine level and the fallback share the rest
+		coarse.timeLimit /= 3;
+		coarse.g = roomGraph;
+		coarse.addConstraints();
+		if (coarse.warmStart)
+			coarse.setWarmStart();
+		coarse.setParameters(*coarse.model);
+		watchSubSolver(coarse);
+		coarse.model->optimize();
+		if (coarse.model->get(GRB_IntAttr_SolCount) == 0) {
+			if (verbose)
+				std::cout << "Coarse floor plan has no solution, solving the split rooms directly" << std::endl;
+			return false;
+		}
+		for (int r = 0; r < num_rooms; ++r)
+			rooms[r] = { coarse.x_i[r].get(GRB_DoubleAttr_X), coarse.y_i[r].get(GRB_DoubleAttr_X),
+				coarse.l_i[r].get(GRB_DoubleAttr_X), coarse.w_i[r].get(GRB_DoubleAttr_X) };
+	}
+	catch (GRBException& e) {
+		std::cout << "Error code = " << e.getErrorCode() << std::endl;
+		std::cout << e.getMessage() << std::endl;
+		return false;
+	}
+
+	// Fine level: splitGraph2 turns room r into the rectangles r and r + num_rooms. Each one is bounded to its
+	// room's coarse box grown by coarseMargin, and starts from the half of that box it was split into. The halves
+	// are only a MIP start, g keeps no pos/size until a level finds a solution.
+	int num_vertices = boost::num_vertices(g);
+	std::vector<std::vector<double>> halves(num_vertices);
+	std::vector<GRBVar> boundedVars;
+	std::vector<double> lower, upper;
+	std::vector<BoxRange> ranges(num_vertices);
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		int id = g[*vi].id, r = id % num_rooms;
+		const std::vector<double>& room = rooms[r];
+		const VertexProperties& parent = roomGraph[boost::vertex(r, roomGraph)];
+		// Same split axis and halves as splitGraph2: the first rectangle is the front/right half
+		bool split_y = !parent.target_size.empty() && parent.target_size[1] > parent.target_size[0];
+		double sign = id < num_rooms ? 1 : -1;
+		double height = g[*vi].target_size.size() > 2 ? g[*vi].target_size[2] : 0;
+		std::vector<double>& half = halves[id];
+		half = { room[0], room[1], height / 2, room[2], room[3], height };
+		half[split_y ? 1 : 0] += sign * room[split_y ? 3 : 2] / 4;
+		half[split_y ? 4 : 3] /= 2;
+
+		BoxRange& range = ranges[id];
+		range = objectRange(g[*vi]);
+		double lo[2], hi[2];
+		for (int k = 0; k < 2; ++k) {
+			double margin = coarseMargin * boundary.size[k];
+			lo[k] = std::max(boundary.origin_pos[k], room[k] - room[k + 2] / 2 - margin);
+			hi[k] = std::min(boundary.origin_pos[k] + boundary.size[k], room[k] + room[k + 2] / 2 + margin);
+			range.smax[k] = std::min(range.smax[k], hi[k] - lo[k]);
+			range.cmin[k] = std::max(range.cmin[k], lo[k] + range.smin[k] / 2);
+			range.cmax[k] = std::min(range.cmax[k], hi[k] - range.smin[k] / 2);
+		}
+		for (const GRBVar& var : { x_i[id], y_i[id], l_i[id], w_i[id] })
+			boundedVars.push_back(var);
+		lower.insert(lower.end(), { range.cmin[0], range.cmin[1], range.smin[0], range.smin[1] });
+		upper.insert(upper.end(), { std::max(range.cmin[0], range.cmax[0]), std::max(range.cmin[1], range.cmax[1]),
+			std::max(range.smin[0], range.smax[0]), std::max(range.smin[1], range.smax[1]) });
+	}
+	if (warmStart)
+		setWarmStart(halves);
+
+	// With Presolve off the bounds alone do not remove binaries, so the disjunctions they decide are fixed here
+	std::vector<BoxRange> obstacleRanges(obstacles.size());
+	for (size_t i = 0; i < obstacles.size(); ++i)
+		for (int k = 0; k < 3; ++k) {
+			obstacleRanges[i].cmin[k] = obstacleRanges[i].cmax[k] = obstacles[i].pos[k];
+			obstacleRanges[i].smin[k] = obstacleRanges[i].smax[k] = obstacles[i].size[k];
+		}
+	auto fix = [&](const DisjunctionPair& pair, const BoxRange& ra, const BoxRange& rb) {
+		unsigned sides = feasibleSides(ra, rb);
+		// Apart on some axis: the side pointing away holds for every placement
+		if (sides == 0) {
+			AABB ba = ra.bounds(), bb = rb.bounds();
+			for (int k = 0; k < 2 && sides == 0; ++k) {
+				if (ba.lo[k] >= bb.hi[k])
+					sides = 1u << (2 * k);
+				else if (ba.hi[k] <= bb.lo[k])
+					sides = 1u << (2 * k + 1);
+			}
+		}
+		bool single = (sides & (sides - 1)) == 0;
+		for (int side = 0; side < 6; ++side) {
+			if (pair.sigma[side] < 0)
+				continue;
+			bool open = sides & (1u << side);
+			if (open && !single)
+				continue;
+			boundedVars.push_back(vars[pair.sigma[side]]);
+			lower.push_back(open ? 1 : 0);
+			upper.push_back(open ? 1 : 0);
+		}
+	};
+	for (const DisjunctionPair& pair : nonOverlapPairs)
+		fix(pair, ranges[pair.first], ranges[pair.second]);
+	for (const DisjunctionPair& pair : obstaclePairs)
+		fix(pair, ranges[pair.first], obstacleRanges[pair.second]);
+
+	bool found = false;
+	double* old_lower = model->get(GRB_DoubleAttr_LB, boundedVars.data(), boundedVars.size());
+	double* old_upper = model->get(GRB_DoubleAttr_UB, boundedVars.data(), boundedVars.size());
+	try {
+		model->set(GRB_DoubleAttr_LB, boundedVars.data(), lower.data(), boundedVars.size());
+		model->set(GRB_DoubleAttr_UB, boundedVars.data(), upper.data(), boundedVars.size());
+		setParameters(*model);
+		model->optimize();
+		commitLazyRows();
+		recordResult(*model);
+		found = model->get(GRB_IntAttr_SolCount) > 0;
+		if (found)
+			storeSolution();
+	}
+	catch (GRBException& e) {
+		std::cout << "Error code = " << e.getErrorCode() << std::endl;
+		std::cout << e.getMessage() << std::endl;
+		found = false;
+	}
+	// Restore the bounds so that resolve() and the fallback in solve() see the full model
+	model->set(GRB_DoubleAttr_LB, boundedVars.data(), old_lower, boundedVars.size());
+	model->set(GRB_DoubleAttr_UB, boundedVars.data(), old_upper, boundedVars.size());
+	delete[] old_lower;
+	delete[] old_upper;
+	if (!found && verbose)
+		std::cout << "No floor plan near the coarse solution, solving the split rooms directly" << std::endl;
+	return found;
+}
+
+std::vector<int> Solver::findClusters(int max_clusters) const
+{
+	// Connected components of the relation edges (union-find on object ids)
+	int num_vertices = boost::num_vertices(g);
+	std::vector<int> parent(num_vertices);
+	std::iota(parent.begin(), parent.end(), 0);
+	std::function<int(int)> root = [&](int v) { return parent[v] == v ? v : parent[v] = root(parent[v]); };
+	EdgeIterator ei, ei_end;
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei)
+		parent[root(g[boost::source(*ei, g)].id)] = root(g[boost::target(*ei, g)].id);
+	std::map<int, std::vector<int>> components;
+	for (int id = 0; id < num_vertices; ++id)
+		components[root(id)].push_back(id);
+	if (components.size() < 2 || max_clusters < 2)
+		return {};
+
+	// Components are packed into at most max_clusters clusters, largest first into the smallest cluster,
+	// so that the cluster MIPs have similar sizes and single objects do not each get their own model
+	std::vector<const std::vector<int>*> order;
+	for (const auto& [r, members] : components)
+		order.push_back(&members);
+	std::stable_sort(order.begin(), order.end(), [](const std::vector<int>* a, const std::vector<int>* b) { return a->size() > b->size(); });
+	int num_clusters = std::min<int>(max_clusters, order.size());
+	std::vector<int> load(num_clusters, 0), cluster(num_vertices, -1);
+	for (const std::vector<int>* members : order) {
+		int c = std::min_element(load.begin(), load.end()) - load.begin();
+		load[c] += members->size();
+		for (int id : *members)
+			cluster[id] = c;
+	}
+	return cluster;
+}
+
+bool Solver::solveClusters()
+{
+	int num_vertices = boost::num_vertices(g);
+	int workers = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+	std::vector<int> cluster = findClusters(std::max(2, workers));
+	if (cluster.empty())
+		return false;
+	int num_clusters = *std::max_element(cluster.begin(), cluster.end()) + 1;
+	// Object ids of each cluster in ascending order, the id inside the cluster model is the position in that list
+	std::vector<std::vector<int>> members(num_clusters);
+	std::vector<int> local(num_vertices);
+	for (int id = 0; id < num_vertices; ++id) {
+		local[id] = members[cluster[id]].size();
+		members[cluster[id]].push_back(id);
+	}
+	if (verbose)
+		std::cout << "Solving " << num_clusters << " clusters of " << num_vertices << " objects" << std::endl;
+
+	// Every cluster is a Solver of its own (own GRBEnv) on the induced subgraph, with the same boundary and obstacles
+	std::vector<SceneGraph> results(num_clusters);
+	std::vector<char> solved(num_clusters, 0);
+	auto solveCluster = [&](int c) {
+		try {
+			Solver sub;
+			configureSubSolver(sub);
+			sub.floorplan = false;
+			sub.threads = std::max(1, workers / num_clusters);
+			// The clusters run side by side on half of the budget, reconciliation and fallback share the rest
+			sub.timeLimit /= 2;
+			for (int id : members[c]) {
+				VertexProperties vp = g[boost::vertex(id, g)];
+				vp.id = local[id];
+				boost::add_vertex(vp, sub.g);
+			}
+			EdgeIterator ei, ei_end;
+			for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+				int s = g[boost::source(*ei, g)].id, t = g[boost::target(*ei, g)].id;
+				if (cluster[s] == c)
+					boost::add_edge(boost::vertex(local[s], sub.g), boost::vertex(local[t], sub.g), g[*ei], sub.g);
+			}
+			sub.addConstraints();
+			if (sub.warmStart)
+				sub.setWarmStart();
+			// No IIS handling here: an infeasible cluster falls back to the full model, which reports the conflict
+			sub.setParameters(*sub.model);
+			watchSubSolver(sub);
+			sub.model->optimize();
+			if (sub.model->get(GRB_IntAttr_SolCount) == 0)
+				return;
+			sub.storeSolution();
+			results[c] = sub.g;
+			solved[c] = 1;
+		}
+		catch (GRBException& e) {
+			std::cout << "Cluster " << c << ": error code = " << e.getErrorCode() << ", " << e.getMessage() << std::endl;
+		}
+	};
+	std::vector<std::thread> pool;
+	for (int c = 0; c < num_clusters; ++c)
+		pool.emplace_back(solveCluster, c);
+	for (std::thread& t : pool)
+		t.join();
+	if (std::count(solved.begin(), solved.end(), 0) > 0) {
+		if (verbose)
+			std::cout << "A cluster has no solution, solving the full model instead" << std::endl;
+		return false;
+	}
+	// The cluster boxes are only a MIP start and the source of the fixings, g keeps no pos/size until the
+	// reconciliation finds a solution
+	std::vector<std::vector<double>> boxes(num_vertices);
+	for (int id = 0; id < num_vertices; ++id) {
+		const VertexProperties& vp = results[cluster[id]][boost::vertex(local[id], results[cluster[id]])];
+		boxes[id] = { vp.pos[0], vp.pos[1], vp.pos[2], vp.size[0], vp.size[1], vp.size[2] };
+	}
+	if (warmStart)
+		setWarmStart(boxes);
+
+	// Reconciliation: the disjunctions inside a cluster and against obstacles are fixed to a side the cluster
+	// solution separates, so only the binaries between clusters are left to branch on
+	std::vector<GRBVar> fixedVars;
+	std::vector<double> lower, upper;
+	auto fix = [&](const DisjunctionPair& pair, const std::vector<double>& a, const std::vector<double>& b) {
+		const double eps = 1e-6;
+		int chosen = -1;
+		for (int side = 0; side < 6 && chosen < 0; ++side) {
+			int k = side / 2;
+			bool separated = side % 2 == 0 ? a[k] - a[k + 3] / 2 >= b[k] + b[k + 3] / 2 - eps : a[k] + a[k + 3] / 2 <= b[k] - b[k + 3] / 2 + eps;
+			if (pair.sigma[side] >= 0 && separated)
+				chosen = side;
+		}
+		if (chosen < 0)
+			return;
+		for (int side = 0; side < 6; ++side) {
+			if (pair.sigma[side] < 0)
+				continue;
+			fixedVars.push_back(vars[pair.sigma[side]]);
+			lower.push_back(side == chosen ? 1 : 0);
+			upper.push_back(side == chosen ? 1 : 0);
+		}
+	};
+	for (const DisjunctionPair& pair : nonOverlapPairs)
+		if (cluster[pair.first] == cluster[pair.second])
+			fix(pair, boxes[pair.first], boxes[pair.second]);
+	for (const DisjunctionPair& pair : obstaclePairs) {
+		const Obstacles& o = obstacles[pair.second];
+		fix(pair, boxes[pair.first], { o.pos[0], o.pos[1], o.pos[2], o.size[0], o.size[1], o.size[2] });
+	}
+	bool found = false;
+	try {
+		if (!fixedVars.empty()) {
+			model->set(GRB_DoubleAttr_LB, fixedVars.data(), lower.data(), fixedVars.size());
+			model->set(GRB_DoubleAttr_UB, fixedVars.data(), upper.data(), fixedVars.size());
+		}
+		setParameters(*model);
+		model->optimize();
+		commitLazyRows();
+		recordResult(*model);
+		found = model->get(GRB_IntAttr_SolCount) > 0;
+		if (found)
+			storeSolution();
+	}
+	catch (GRBException& e) {
+		std::cout << "Error code = " << e.getErrorCode() << std::endl;
+		std::cout << e.getMessage() << std::endl;
+		found = false;
+	}
+	// Release the fixings again so that resolve() and the fallback in solve() see the full model
+	if (!fixedVars.empty()) {
+		std::fill(lower.begin(), lower.end(), 0);
+		std::fill(upper.begin(), upper.end(), 1);
+		model->set(GRB_DoubleAttr_LB, fixedVars.data(), lower.data(), fixedVars.size());
+		model->set(GRB_DoubleAttr_UB, fixedVars.data(), upper.data(), fixedVars.size());
+	}
+	if (!found && verbose)
+		std::cout << "Clusters could not be reconciled, solving the full model instead" << std::endl;
+	return found;
+}
+
 void Solver::saveGraph()
 {
-    std::ofstream file_in(std::string(ASSETS_DIR) + "/" + "SceneGraph/graph_in.dot");
-    if (!file_in.is_open()) {
-        std::cerr << "Failed to open file for writing: graph_in.dot" << std::endl;
-    } else {
-        boost::write_graphviz(file_in, inputGraph, vertex_writer_in<SceneGraph::vertex_descriptor>(inputGraph), 
-            edge_writer<SceneGraph::edge_descriptor>(inputGraph));
-    }
-    
-    std::ofstream file_out(std::string(ASSETS_DIR) + "/" + "SceneGraph/graph_out.dot");
-    if (!file_out.is_open()) {
-        std::cerr << "Failed to open file for writing: graph_out.dot" << std::endl;
-    } else {
-        boost::write_graphviz(file_out, g, vertex_writer_out<SceneGraph::vertex_descriptor>(g),
-            edge_writer<SceneGraph::edge_descriptor>(g));
-    }
-	model.write(std::string(ASSETS_DIR) + "/" + "SceneGraph/model.lp");
+	auto save_start = std::chrono::steady_clock::now();
+	if (saveDebugFiles) {
+		std::ofstream file_in(std::string(ASSETS_DIR) + "/" + "SceneGraph/graph_in.dot");
+		if (!file_in.is_open()) {
+			std::cerr << "Failed to open file for writing: graph_in.dot" << std::endl;
+		} else {
+			boost::write_graphviz(file_in, inputGraph, vertex_writer_in<SceneGraph::vertex_descriptor>(inputGraph), 
+				edge_writer<SceneGraph::edge_descriptor>(inputGraph));
+		}
+		
+		std::ofstream file_out(std::string(ASSETS_DIR) + "/" + "SceneGraph/graph_out.dot");
+		if (!file_out.is_open()) {
+			std::cerr << "Failed to open file for writing: graph_out.dot" << std::endl;
+		} else {
+			boost::write_graphviz(file_out, g, vertex_writer_out<SceneGraph::vertex_descriptor>(g),
+				edge_writer<SceneGraph::edge_descriptor>(g));
+		}
+		if (model)
+			model->write(std::string(ASSETS_DIR) + "/" + "SceneGraph/model.lp");
+	}
 
 	try
     {
@@ -591,32 +2096,50 @@ void Solver::saveGraph()
 				j["plan_info"].push_back(graphProcessor.plan_info[i]);
 		}
 		else {
+			// Plans applied by the conflict policy, empty when the input had no conflict
 			j["conflict_info"] = "";
-			j["plan_info"] = {};
-			for (auto i = 0; i < j["vertices"].size(); ++i) {
-				j["vertices"][i]["position"] = {
-					g[boost::vertex(i, g)].pos[0],
-					g[boost::vertex(i, g)].pos[1],
-					g[boost::vertex(i, g)].pos[2]
-				};
-				j["vertices"][i]["size"] = {
-					g[boost::vertex(i, g)].size[0],
-					g[boost::vertex(i, g)].size[1],
-					g[boost::vertex(i, g)].size[2]
-				};
+			j["plan_info"] = graphProcessor.plan_info;
+			// Solved vertices per input vertex: none for an object removed by a conflict plan, two for the halves
+			// of a split floor plan room
+			std::vector<std::vector<VertexDescriptor>> parts(j["vertices"].size());
+			VertexIterator vi, vi_end;
+			for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi)
+				if (g[*vi].input_index >= 0 && g[*vi].input_index < (int)parts.size())
+					parts[g[*vi].input_index].push_back(*vi);
+			for (size_t i = 0; i < parts.size(); ++i) {
+				j["vertices"][i]["removed"] = parts[i].empty();
+				// No incumbent (e.g. time limit reached without a feasible solution)
+				if (parts[i].empty() || g[parts[i][0]].pos.empty())
+					continue;
+				// Bounding box of the parts
+				double lo[3], hi[3];
+				for (int k = 0; k < 3; ++k) {
+					lo[k] = GRB_INFINITY;
+					hi[k] = -GRB_INFINITY;
+					for (VertexDescriptor v : parts[i]) {
+						lo[k] = std::min(lo[k], g[v].pos[k] - g[v].size[k] / 2);
+						hi[k] = std::max(hi[k], g[v].pos[k] + g[v].size[k] / 2);
+					}
+				}
+				j["vertices"][i]["position"] = { (lo[0] + hi[0]) / 2, (lo[1] + hi[1]) / 2, (lo[2] + hi[2]) / 2 };
+				j["vertices"][i]["size"] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
 			}
 		}
 
-		std::string outputpath = std::string(ASSETS_DIR) + "/" + "SceneGraph/output.json";
-        std::ofstream ofs(outputpath);
+		stats.saveTime = secondsSince(save_start);
+		j["stats"] = stats.toJson();
+
+		std::string path = outputpath.empty() ? std::string(ASSETS_DIR) + "/" + "SceneGraph/output.json" : outputpath;
+        std::ofstream ofs(path);
         if (!ofs.is_open())
         {
-            std::cerr << "Failed to open output JSON file: " << outputpath << std::endl;
+            std::cerr << "Failed to open output JSON file: " << path << std::endl;
             return;
         }
         ofs << j.dump(4) << std::endl;
         ofs.close();
-        std::cout << "JSON file has been updated and saved to: " << outputpath << std::endl;
+        if (verbose)
+            std::cout << "JSON file has been updated and saved to: " << path << std::endl;
     }
     catch (const std::exception& e)
     {
@@ -626,6 +2149,7 @@ void Solver::saveGraph()
 
 void Solver::solve()
 {
+	cancelRequested = false;
 	if (inputGraph.m_vertices.empty()) {
 		std::cerr << "Scene Graph is empty!" << std::endl;
 	}
@@ -634,16 +2158,272 @@ void Solver::solve()
 		std::cerr << "Conflict Constraints Found" << std::endl;
 	}
 	else {
+		stats = keepReadStats(stats);
+		// HiGHS takes no quadratic objective together with binaries; objectiveMode is kept for the next solve
+		modelObjective = backend == MipBackendType::Gurobi ? objectiveMode : ObjectiveMode::Linear;
+		if (modelObjective != objectiveMode && verbose)
+			std::cout << "The HiGHS backend solves MILPs only, using the linear objective" << std::endl;
 		clearModel();
-		addConstraints();
-    	optimizeModel();
+		{
+			PhaseTimer timer(stats.buildTime);
+			addConstraints();
+			if (backend == MipBackendType::Gurobi)
+				model->update();
+		}
+		if (backend == MipBackendType::Gurobi) {
+			stats.numVars = model->get(GRB_IntAttr_NumVars);
+			stats.numBinVars = model->get(GRB_IntAttr_NumBinVars);
+			stats.numConstrs = model->get(GRB_IntAttr_NumConstrs);
+			stats.numQConstrs = model->get(GRB_IntAttr_NumQConstrs);
+			stats.numGenConstrs = model->get(GRB_IntAttr_NumGenConstrs);
+			stats.numNZs = model->get(GRB_IntAttr_NumNZs);
+			stats.numQNZs = model->get(GRB_IntAttr_NumQNZs);
+		}
+		else {
+			stats.numVars = builder.numVars();
+			stats.numBinVars = builder.numBinaries();
+			stats.numConstrs = builder.numRows() - builder.numIndicators();
+			stats.numQConstrs = builder.numQuadRows();
+			stats.numGenConstrs = builder.numIndicators();
+			stats.numNZs = builder.numNonzeros();
+			stats.numQNZs = 0;
+		}
+		stats.nonOverlapPairs = nonOverlapPairs.size();
+		stats.obstaclePairs = obstaclePairs.size();
+		// Only a Gurobi model can be edited in place by resolve()
+		modelBuilt = backend == MipBackendType::Gurobi;
+		needsRebuild = false;
+		solveStart = std::chrono::steady_clock::now();
+		if (backend != MipBackendType::Gurobi) {
+			solveWithBackend();
+			saveGraph();
+			return;
+		}
+		beginIncumbentStream(false);
+		// The floor plan area constraint couples all rooms, so floor plans are never decomposed into clusters
+		bool solved = false;
+		{
+			PhaseTimer timer(stats.optimizeTime);
+			solved = floorplan ? coarseToFine && solveCoarseToFine() : decompose && solveClusters();
+		}
+		if (!solved) {
+			if (warmStart) {
+				PhaseTimer timer(stats.warmStartTime);
+				setWarmStart();
+			}
+			optimizeModel();
+		}
+	}
+	saveGraph();
+}
+
+void Solver::preview()
+{
+	if (inputGraph.m_vertices.empty()) {
+		std::cerr << "Scene Graph is empty!" << std::endl;
+		return;
+	}
+	if (!graphProcessor.conflict_info.empty()) {
+		std::cout << graphProcessor.conflict_info << std::endl;
+		std::cerr << "Conflict Constraints Found" << std::endl;
+		saveGraph();
+		return;
+	}
+	stats = keepReadStats(stats);
+	HeuristicResult result = runHeuristic();
+	storeHeuristic(result);
+	if (!result.feasible())
+		std::cerr << "Heuristic layout violates the constraints by " << result.violation << std::endl;
+	saveGraph();
+}
+
+void Solver::resolve()
+{
+	// The other backends always solve from scratch
+	if (!modelBuilt || needsRebuild || backend != MipBackendType::Gurobi) {
+		if (needsRebuild) {
+			// Structural change: process the edited input graph again, then build from scratch
+			graphProcessor.reset();
+			stats.processTime = 0;
+			PhaseTimer timer(stats.processTime);
+			graphProcessor.policy = conflictPolicy;
+			graphProcessor.costs = conflictCosts;
+			g = graphProcessor.process(inputGraph, boundary, obstacles);
+			if (floorplan) {
+				roomGraph = g;
+				g = graphProcessor.splitGraph2(g, boundary);
+			}
+		}
+		solve();
+		return;
+	}
+	// Bounds and RHS values were edited in place, only the objective has to be rebuilt
+	cancelRequested = false;
+	graphProcessor.reset();
+	// The model sizes stay, the timings and the result are redone
+	stats.pairFilterTime = stats.buildTime = stats.warmStartTime = stats.optimizeTime = stats.iisTime = stats.saveTime = 0;
+	stats.heuristicTime = 0;
+	stats.heuristic = false;
+	{
+		PhaseTimer timer(stats.buildTime);
+		buildObjective();
 	}
+	if (lastSolution.size() == vars.size())
+		model->set(GRB_DoubleAttr_Start, vars.data(), lastSolution.data(), vars.size());
+	beginIncumbentStream(true);
+	solveStart = std::chrono::steady_clock::now();
+	optimizeModel();
 	saveGraph();
 }
 
+GRBVar Solver::modelVar(int index) const
+{
+	return index >= 0 ? vars[index] : GRBVar();
+}
+
+VertexDescriptor Solver::findVertex(const SceneGraph& graph, int id) const
+{
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(graph); vi != vi_end; ++vi)
+		if (graph[*vi].id == id)
+			return *vi;
+	return boost::graph_traits<SceneGraph>::null_vertex();
+}
+
+VertexDescriptor Solver::inputVertex(int id) const
+{
+	VertexDescriptor v = findVertex(g, id);
+	if (v == boost::graph_traits<SceneGraph>::null_vertex() || g[v].input_index < 0 || g[v].input_index >= (int)boost::num_vertices(inputGraph))
+		return boost::graph_traits<SceneGraph>::null_vertex();
+	return boost::vertex(g[v].input_index, inputGraph);
+}
+
+bool Solver::updateTolerance(ConstraintKind kind, int id, const std::vector<double>& target, const std::vector<double>& tolerance)
+{
+	// Parts 2k / 2k+1 are the lower / upper bound on axis k, see addConstraints
+	int updated = 0;
+	for (size_t i = 0; i < constraints.size(); ++i) {
+		const ConstraintTag& tag = constraintTags[i];
+		if (tag.kind != kind || tag.first != id)
+			continue;
+		int axis = tag.part / 2;
+		double rhs = tag.part % 2 == 0 ? target[axis] - tolerance[axis] : target[axis] + tolerance[axis];
+		constraints[i].set(GRB_DoubleAttr_RHS, rhs);
+		updated++;
+	}
+	return updated > 0;
+}
+
+bool Solver::inSymmetryClass(int id) const
+{
+	return breakSymmetry && id >= 0 && id < (int)symmetryClassOf.size() && symmetryClassOf[id] >= 0;
+}
+
+bool Solver::updateTargetSize(int id, const std::vector<double>& target_size)
+{
+	VertexDescriptor v = findVertex(g, id);
+	if (v == boost::graph_traits<SceneGraph>::null_vertex() || target_size.size() < 3) {
+		std::cerr << "updateTargetSize: unknown object " << id << std::endl;
+		return false;
+	}
+	bool had_target = !g[v].target_size.empty();
+	BoxRange old_range = objectRange(g[v]);
+	g[v].target_size = target_size;
+	// The split floorplan graph is derived from the input graph, keep both in sync
+	VertexDescriptor u = inputVertex(id);
+	if (u != boost::graph_traits<SceneGraph>::null_vertex())
+		inputGraph[u].target_size = target_size;
+	// The big-Ms and pruned disjunctions stay valid as long as the object can only reach less than before, the
+	// symmetry rows only as long as the object stays interchangeable with its class
+	if (floorplan || !had_target || inSymmetryClass(id) || !old_range.contains(objectRange(g[v])) ||
+		modelObjective == ObjectiveMode::Linear) {
+		needsRebuild = true;
+		return false;
+	}
+	if (!g[v].size_tolerance.empty())
+		updateTolerance(ConstraintKind::SizeTolerance, id, target_size, g[v].size_tolerance);
+	return true;
+}
+
+bool Solver::updateTargetPos(int id, const std::vector<double>& target_pos)
+{
+	VertexDescriptor v = findVertex(g, id);
+	if (v == boost::graph_traits<SceneGraph>::null_vertex() || target_pos.size() < 3) {
+		std::cerr << "updateTargetPos: unknown object " << id << std::endl;
+		return false;
+	}
+	bool had_target = !g[v].target_pos.empty();
+	BoxRange old_range = objectRange(g[v]);
+	g[v].target_pos = target_pos;
+	VertexDescriptor u = inputVertex(id);
+	if (u != boost::graph_traits<SceneGraph>::null_vertex())
+		inputGraph[u].target_pos = target_pos;
+	// The big-Ms and pruned disjunctions stay valid as long as the object can only reach less than before, the
+	// symmetry rows only as long as the object stays interchangeable with its class
+	if (floorplan || !had_target || inSymmetryClass(id) || !old_range.contains(objectRange(g[v])) ||
+		modelObjective == ObjectiveMode::Linear) {
+		needsRebuild = true;
+		return false;
+	}
+	if (!g[v].pos_tolerance.empty())
+		updateTolerance(ConstraintKind::PosTolerance, id, target_pos, g[v].pos_tolerance);
+	return true;
+}
+
+bool Solver::updateEdgeDistance(int source_id, int target_id, EdgeType type, double distance)
+{
+	// GraphProcessor::process stores RightOf/Behind/Under as reversed LeftOf/FrontOf/Above edges
+	auto matches = [&](EdgeType edge_type, int s, int t, int from, int to) {
+		if (edge_type == type && s == from && t == to)
+			return true;
+		return type < CloseBy && edge_type == (type % 2 == 0 ? type + 1 : type - 1) && s == to && t == from;
+	};
+	// The input graph keeps the vertex order it was read in, its edges are matched by input index
+	VertexDescriptor input_source = inputVertex(source_id), input_target = inputVertex(target_id);
+	EdgeIterator ei, ei_end;
+	if (input_source != boost::graph_traits<SceneGraph>::null_vertex() && input_target != boost::graph_traits<SceneGraph>::null_vertex())
+		for (boost::tie(ei, ei_end) = boost::edges(inputGraph); ei != ei_end; ++ei)
+			if (matches(inputGraph[*ei].type, (int)boost::source(*ei, inputGraph), (int)boost::target(*ei, inputGraph),
+				(int)input_source, (int)input_target))
+				inputGraph[*ei].distance = distance;
+	bool found = false, rebuild = false;
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+		if (!matches(g[*ei].type, g[boost::source(*ei, g)].id, g[boost::target(*ei, g)].id, source_id, target_id))
+			continue;
+		found = true;
+		EdgeProperties& ep = g[*ei];
+		bool was_free = ep.distance >= 0;
+		ep.distance = distance;
+		// The linear objective has the distance in the rows of its error variables
+		if (floorplan || inSymmetryClass(source_id) || inSymmetryClass(target_id) || modelObjective == ObjectiveMode::Linear) {
+			rebuild = true;
+			continue;
+		}
+		if (was_free == (distance >= 0) || (ep.type != LeftOf && ep.type != RightOf && ep.type != FrontOf && ep.type != Behind))
+			continue;
+		// A negative distance turns the ordering inequality into contact, only the sense changes
+		int ids = g[boost::source(*ei, g)].id, idt = g[boost::target(*ei, g)].id;
+		char sense = GRB_EQUAL;
+		if (distance >= 0)
+			sense = (ep.type == LeftOf || ep.type == Behind) ? GRB_LESS_EQUAL : GRB_GREATER_EQUAL;
+		for (size_t i = 0; i < constraints.size(); ++i) {
+			const ConstraintTag& tag = constraintTags[i];
+			if (tag.kind == ConstraintKind::Relation && tag.first == ids && tag.second == idt && tag.part == ep.type)
+				constraints[i].set(GRB_CharAttr_Sense, sense);
+		}
+	}
+	if (!found) {
+		std::cerr << "updateEdgeDistance: no such edge " << source_id << " -> " << target_id << std::endl;
+		return false;
+	}
+	needsRebuild = needsRebuild || rebuild;
+	return !rebuild;
+}
+
 void Solver::readSceneGraph(const std::string& path, float wallwidth)
 {
 	reset();
+	auto read_start = std::chrono::steady_clock::now();
 	inputpath = path;
 	// Read JSON file
 	std::ifstream file(path);
@@ -661,6 +2441,7 @@ void Solver::readSceneGraph(const std::string& path, float wallwidth)
 	
 	if (!floorplan)
 	{
+		PhaseTimer timer(stats.clipperTime);
 		boundary.origin_pos[0] += wallwidth / 2; boundary.origin_pos[1] += wallwidth / 2;
 		boundary.size[0] -= wallwidth; boundary.size[1] -= wallwidth;
 		ClipperLib::Path boundaryp;
@@ -828,6 +2609,7 @@ void Solver::readSceneGraph(const std::string& path, float wallwidth)
     // std::uniform_int_distribution<> dis(0, 1);
     for (const auto& vertex : scene_graph_json["vertices"]) {
         VertexProperties vp;
+        vp.input_index = boost::num_vertices(inputGraph);
         vp.label = vertex["label"];
         vp.id = vertex["id"];
         vp.boundary = vertex["boundary"];
@@ -880,14 +2662,26 @@ void Solver::readSceneGraph(const std::string& path, float wallwidth)
 			ep.align_edge = -1;
 			ep.xyoffset = {};
 		}
+		ep.weight = edge.value("weight", 1.0);
         auto source = vertex(edge["source"], inputGraph);
         auto target = vertex(edge["target"], inputGraph);
         add_edge(source, target, ep, inputGraph);
     }
 
-    g = graphProcessor.process(inputGraph, boundary, obstacles);
-	if (floorplan)
-    	g = graphProcessor.splitGraph2(g, boundary);
+	stats.parseTime = secondsSince(read_start) - stats.clipperTime;
+	{
+		PhaseTimer timer(stats.processTime);
+		graphProcessor.policy = conflictPolicy;
+		graphProcessor.costs = conflictCosts;
+		g = graphProcessor.process(inputGraph, boundary, obstacles);
+		if (floorplan) {
+			roomGraph = g;
+			g = graphProcessor.splitGraph2(g, boundary);
+		}
+	}
+
+	if (!verbose)
+		return;
 
 	VertexIterator vi, vi_end;
     for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
@@ -909,29 +2703,54 @@ void Solver::reset()
 {
 	inputGraph.clear();
 	g.clear();
+	roomGraph.clear();
 	boundary = Boundary();
 	obstacles.clear();
 	doors.clear();
 	windows.clear();
 	graphProcessor.reset();
 	clearModel();
+	stats = SolveStats();
+	if (incumbentStream.is_open())
+		incumbentStream.close();
 }
 	
 
 void Solver::clearModel() {
-	auto vars = model.getVars();
-	for (auto i = 0; i < model.get(GRB_IntAttr_NumVars); ++i) {
-		model.remove(vars[i]);
-	}
-	auto constrs = model.getConstrs();
-	for (auto i = 0; i < model.get(GRB_IntAttr_NumConstrs); ++i) {
-		model.remove(constrs[i]);
-	}
-	auto qconstrs = model.getQConstrs();
-	for (auto i = 0; i < model.get(GRB_IntAttr_NumQConstrs); ++i) {
-		model.remove(qconstrs[i]);
+	if (model) {
+		auto modelVars = model->getVars();
+		for (auto i = 0; i < model->get(GRB_IntAttr_NumVars); ++i) {
+			model->remove(modelVars[i]);
+		}
+		delete[] modelVars;
+		auto constrs = model->getConstrs();
+		for (auto i = 0; i < model->get(GRB_IntAttr_NumConstrs); ++i) {
+			model->remove(constrs[i]);
+		}
+		delete[] constrs;
+		auto qconstrs = model->getQConstrs();
+		for (auto i = 0; i < model->get(GRB_IntAttr_NumQConstrs); ++i) {
+			model->remove(qconstrs[i]);
+		}
+		delete[] qconstrs;
+		auto genconstrs = model->getGenConstrs();
+		for (auto i = 0; i < model->get(GRB_IntAttr_NumGenConstrs); ++i) {
+			model->remove(genconstrs[i]);
+		}
+		delete[] genconstrs;
+		model->update();
 	}
-	model.update();
+	builder.clear();
+	constraints.clear();
+	constraintTags.clear();
+	indicatorConstraints.clear();
+	indicatorTags.clear();
+	lastSolution.clear();
+	vars.clear();
+	nonOverlapPairs.clear();
+	obstaclePairs.clear();
+	lazyPairs.clear();
+	modelBuilt = false;
 }
 
 float Solver::getboundaryMaxSize()
@@ -939,128 +2758,161 @@ float Solver::getboundaryMaxSize()
 	return std::max(boundary.size[0], std::max(boundary.size[1], boundary.size[2]));
 }
 
+void Solver::screeningRows(std::vector<ModelBuilder::Constr>& rows, std::vector<ConstraintTag>& tags) const
+{
+	int num_vertices = boost::num_vertices(g);
+	int dims = floorplan ? 2 : 3;
+	std::vector<std::array<ModelBuilder::Var, 6>> box(num_vertices);
+	for (int i = 0; i < num_vertices; ++i)
+		for (int k = 0; k < 6; ++k)
+			box[i][k].index = 6 * i + k;
+	auto add = [&](const ModelBuilder::Constr& row, const ConstraintTag& tag) {
+		rows.push_back(row);
+		tags.push_back(tag);
+	};
+	VertexIterator vi, vi_end;
+	for (boost::tie(vi, vi_end) = boost::vertices(g); vi != vi_end; ++vi) {
+		const VertexProperties& vp = g[*vi];
+		const std::array<ModelBuilder::Var, 6>& b = box[vp.id];
+		for (int k = 0; k < dims; ++k) {
+			ModelBuilder::Expr c = b[k], s = b[k + 3];
+			add(c - s / 2 >= boundary.origin_pos[k], { ConstraintKind::Inside, vp.id, -1, 2 * k });
+			add(c + s / 2 <= boundary.origin_pos[k] + boundary.size[k], { ConstraintKind::Inside, vp.id, -1, 2 * k + 1 });
+			if (!vp.pos_tolerance.empty() && !vp.target_pos.empty()) {
+				add(c >= vp.target_pos[k] - vp.pos_tolerance[k], { ConstraintKind::PosTolerance, vp.id, -1, 2 * k });
+				add(c <= vp.target_pos[k] + vp.pos_tolerance[k], { ConstraintKind::PosTolerance, vp.id, -1, 2 * k + 1 });
+			}
+			if (!vp.size_tolerance.empty() && !vp.target_size.empty()) {
+				add(s >= vp.target_size[k] - vp.size_tolerance[k], { ConstraintKind::SizeTolerance, vp.id, -1, 2 * k });
+				add(s <= vp.target_size[k] + vp.size_tolerance[k], { ConstraintKind::SizeTolerance, vp.id, -1, 2 * k + 1 });
+			}
+		}
+		if (vp.on_floor && !floorplan)
+			add(b[2] - b[5] / 2 == boundary.origin_pos[2], { ConstraintKind::OnFloor, vp.id, -1, 0 });
+		if (vp.hanging && !floorplan)
+			add(b[2] + b[5] / 2 == boundary.origin_pos[2] + boundary.size[2], { ConstraintKind::Hanging, vp.id, -1, 0 });
+		ModelBuilder::Constr walls[3];
+		if (wallRows(vp, b, walls))
+			for (int part = 0; part < 3; ++part)
+				add(walls[part], { ConstraintKind::Boundary, vp.id, boundary.Orientations[vp.boundary], part });
+		// The corner binaries are left out: the corner edge lies within the span of the candidate corner points
+		const std::vector<int>* corners = nullptr;
+		double sx = 0, sy = 0;
+		switch (vp.corner)
+		{
+			case BOTTOMLEFT: corners = &boundary.BLcorner; sx = -1; sy = -1; break;
+			case BOTTOMRIGHT: corners = &boundary.BRcorner; sx = 1; sy = -1; break;
+			case TOPLEFT: corners = &boundary.TLcorner; sx = -1; sy = 1; break;
+			case TOPRIGHT: corners = &boundary.TRcorner; sx = 1; sy = 1; break;
+			default: break;
+		}
+		if (!corners || corners->empty())
+			continue;
+		double side[2] = { sx, sy };
+		for (int k = 0; k < 2; ++k) {
+			double lo = GRB_INFINITY, hi = -GRB_INFINITY;
+			for (int c : *corners) {
+				lo = std::min(lo, boundary.points[c][k]);
+				hi = std::max(hi, boundary.points[c][k]);
+			}
+			ModelBuilder::Expr edge = b[k] + side[k] / 2 * ModelBuilder::Expr(b[k + 3]);
+			add(edge >= lo, { ConstraintKind::Corner, vp.id, vp.corner, k + 1 });
+			add(edge <= hi, { ConstraintKind::Corner, vp.id, vp.corner, k + 1 });
+		}
+	}
+	EdgeIterator ei, ei_end;
+	for (boost::tie(ei, ei_end) = boost::edges(g); ei != ei_end; ++ei) {
+		int ids = g[boost::source(*ei, g)].id, idt = g[boost::target(*ei, g)].id;
+		ModelBuilder::Constr row;
+		if (relationRow(g[*ei], ids, idt, box, row))
+			add(row, { ConstraintKind::Relation, ids, idt, g[*ei].type });
+	}
+}
+
+bool Solver::screenInfeasibility()
+{
+	std::vector<ModelBuilder::Constr> rows;
+	std::vector<ConstraintTag> tags;
+	screeningRows(rows, tags);
+	std::vector<int> conflict = infeasibleRows(boost::num_vertices(g), rows);
+	if (conflict.empty())
+		return false;
+	graphProcessor.conflict_info = "Infeasible constraints found by the pre-check. List of constraints: \n";
+	graphProcessor.plan_info = {};
+	for (size_t i = 0; i < conflict.size(); ++i)
+		graphProcessor.plan_info.push_back("Constraint " + std::to_string(i) + ": " + constraintName(tags[conflict[i]]) + "\n");
+	return true;
+}
+
 void Solver::handleInfeasibleModel() {
-	model.computeIIS();
+	PhaseTimer timer(stats.iisTime);
+	// Most conflicts are plain chains of relations that do not fit, those are found without an IIS solve
+	if (iisPrecheck && screenInfeasibility())
+		return;
+	// With lazyNonOverlap only the disjunctions added so far can be part of the IIS
+	model->computeIIS();
 	graphProcessor.conflict_info = "Infeasible constraints found in IIS. List of constraints: \n";
 	graphProcessor.plan_info = {};
-    
-    GRBConstr* constrs = model.getConstrs();
-    int numConstrs = model.get(GRB_IntAttr_NumConstrs);
-    
-    std::vector<GRBConstr> infeasibleConstraints;
-    for (int i = 0; i < numConstrs; ++i) {
-        if (constrs[i].get(GRB_IntAttr_IISConstr) == 1) {
-            infeasibleConstraints.push_back(constrs[i]);
-        }
-    }
-	for (int i = 0; i < infeasibleConstraints.size(); ++i) {
-        std::string constrName = infeasibleConstraints[i].get(GRB_StringAttr_ConstrName);
-		graphProcessor.plan_info.push_back("Constraint " + std::to_string(i) + ": " + constrName + "\n");
-        //std::cout << "Constraint " << i << ": " << constrName << std::endl;
-    }
-	model.optimize();
-
-	/*
-    if (!infeasibleConstraints.empty()) {
-        std::cout << "Infeasible constraints found in IIS. List of constraints: " << std::endl;
-        for (int i = 0; i < infeasibleConstraints.size(); ++i) {
-            std::string constrName = infeasibleConstraints[i].get(GRB_StringAttr_ConstrName);
-            std::cout << "Constraint " << i << ": " << constrName << std::endl;
-        }
 
-		std::cout << "Enter the number of the constraint to delete: ";
-        int choice;
-        std::cin >> choice;
-
-        if (choice >= 0 && choice < infeasibleConstraints.size()) {
-            removeIIS(infeasibleConstraints[choice].get(GRB_StringAttr_ConstrName));
-            std::cout << "Constraint " << choice << " removed." << std::endl;
-            model.optimize();
-        } else {
-            std::cout << "Invalid plan, delete the first constriant." << std::endl;
-			removeIIS(infeasibleConstraints[0].get(GRB_StringAttr_ConstrName));
-			std::cout << "Constraint 0 removed." << std::endl;
-			model.optimize();
-        }
-    } else {
-		std::cout << "No infeasible constraints found in IIS." << std::endl;
+	// Names are built here from the tag table, constraints may be unnamed in the model
+	int* iis = model->get(GRB_IntAttr_IISConstr, constraints.data(), constraints.size());
+	std::vector<int> infeasibleConstraints;
+	for (size_t i = 0; i < constraints.size(); ++i) {
+		if (iis[i] == 1) {
+			infeasibleConstraints.push_back(i);
+		}
+	}
+	delete[] iis;
+	std::vector<ConstraintTag> infeasibleTags;
+	for (int i : infeasibleConstraints)
+		infeasibleTags.push_back(constraintTags[i]);
+	for (size_t i = 0; i < indicatorConstraints.size(); ++i)
+		if (indicatorConstraints[i].get(GRB_IntAttr_IISGenConstr) == 1)
+			infeasibleTags.push_back(indicatorTags[i]);
+	for (size_t i = 0; i < infeasibleTags.size(); ++i) {
+		std::string constrName = constraintName(infeasibleTags[i]);
+		graphProcessor.plan_info.push_back("Constraint " + std::to_string(i) + ": " + constrName + "\n");
+		//std::cout << "Constraint " << i << ": " << constrName << std::endl;
 	}
-	*/
 }
 
-void Solver::removeIIS(std::string name) {
+void Solver::removeIIS(const ConstraintTag& tag) {
 	// Unused Now
-	GRBConstr* constrs = model.getConstrs();
-	int numConstrs = model.get(GRB_IntAttr_NumConstrs);
-	size_t pos1 = name.find_first_of("0123456789");
-	size_t pos2 = name.find_last_of("0123456789");
-	//std::string prefix = name.substr(0, pos1) + name.substr(pos1, pos2 - pos1 + 1);
-	std::string prefix = name.substr(0, pos2 + 1);
-	if (name.find("Inside") != std::string::npos || name.find("NonOverlap") != std::string::npos) {
+	if (tag.kind == ConstraintKind::Inside || tag.kind == ConstraintKind::NonOverlap || tag.kind == ConstraintKind::Obstacle) {
 		// TODO
 		std::cout << "It's not recommended to remove Inside/NonOverlap constraint." << std::endl;
+		return;
 	}
-	else if (name.find("Pos_Tolerance") != std::string::npos) {
-		model.remove(model.getConstrByName(prefix + "_x_left"));
-		model.remove(model.getConstrByName(prefix + "_x_right"));
-		model.remove(model.getConstrByName(prefix + "_y_front"));
-		model.remove(model.getConstrByName(prefix + "_y_back"));
-		if (!floorplan) {
-			model.remove(model.getConstrByName(prefix + "_z_bottom"));
-			model.remove(model.getConstrByName(prefix + "_z_top"));
+	// Tolerance, boundary, CloseBy and corner constraints of an object are removed together
+	bool whole_group = tag.kind == ConstraintKind::PosTolerance || tag.kind == ConstraintKind::SizeTolerance ||
+		tag.kind == ConstraintKind::Boundary || tag.kind == ConstraintKind::CloseBy || tag.kind == ConstraintKind::Corner;
+	size_t kept = 0;
+	for (size_t i = 0; i < constraints.size(); ++i) {
+		const ConstraintTag& t = constraintTags[i];
+		if (t.kind == tag.kind && t.first == tag.first && t.second == tag.second && (whole_group || t.part == tag.part)) {
+			model->remove(constraints[i]);
+		}
+		else {
+			constraints[kept] = constraints[i];
+			constraintTags[kept] = t;
+			kept++;
 		}
-		model.update();
-	}
-	else if (name.find("Size_Tolerance") != std::string::npos) {
-		model.remove(model.getConstrByName(prefix + "_l_min"));
-		model.remove(model.getConstrByName(prefix + "_l_max"));
-		model.remove(model.getConstrByName(prefix + "_w_min"));
-		model.remove(model.getConstrByName(prefix + "_w_max"));
-		if (!floorplan) {
-			model.remove(model.getConstrByName(prefix + "_h_min"));
-			model.remove(model.getConstrByName(prefix + "_h_max"));
-		}
-		model.update();
-	}
-	else if (name.find("Boundary") != std::string::npos) {
-		if (name.find("Left") != std::string::npos) {
-			model.remove(model.getConstrByName(prefix + "_Left_eq"));
-			model.remove(model.getConstrByName(prefix + "_Left_ieq"));
-			model.remove(model.getConstrByName(prefix + "_Left_ieqq"));
-		}
-		else if (name.find("Right") != std::string::npos) {
-			model.remove(model.getConstrByName(prefix + "_Right_eq"));
-			model.remove(model.getConstrByName(prefix + "_Right_ieq"));
-			model.remove(model.getConstrByName(prefix + "_Right_ieqq"));
-		}
-		else if (name.find("Front") != std::string::npos) {
-			model.remove(model.getConstrByName(prefix + "_Front_eq"));
-			model.remove(model.getConstrByName(prefix + "_Front_ieq"));
-			model.remove(model.getConstrByName(prefix + "_Front_ieqq"));
-		}
-		else if (name.find("Back") != std::string::npos) {
-			model.remove(model.getConstrByName(prefix + "_Back_eq"));
-			model.remove(model.getConstrByName(prefix + "_Back_ieq"));
-			model.remove(model.getConstrByName(prefix + "_Back_ieqq"));
-		}
-		model.update();
-	}
-	else if (name.find("CloseBy") != std::string::npos) {
-		model.remove(model.getConstrByName(prefix + "ieqa"));
-		model.remove(model.getConstrByName(prefix + "ieqb"));
-		model.remove(model.getConstrByName(prefix + "ieqc"));
-		model.remove(model.getConstrByName(prefix + "ieqd"));
-		model.remove(model.getConstrByName(prefix + "ieqe"));
-		model.update();
-	}
-	else if (name.find("Corner") != std::string::npos) {
-		model.remove(model.getConstrByName(prefix + "eqa"));
-		model.remove(model.getConstrByName(prefix + "eqb"));
-		model.remove(model.getConstrByName(prefix + "eqc"));
-		model.update();
 	}
-	else {
-		model.remove(model.getConstrByName(name));
-		model.update();
+	constraints.resize(kept);
+	constraintTags.resize(kept);
+	kept = 0;
+	for (size_t i = 0; i < indicatorConstraints.size(); ++i) {
+		const ConstraintTag& t = indicatorTags[i];
+		if (t.kind == tag.kind && t.first == tag.first && t.second == tag.second) {
+			model->remove(indicatorConstraints[i]);
+		}
+		else {
+			indicatorConstraints[kept] = indicatorConstraints[i];
+			indicatorTags[kept] = t;
+			kept++;
+		}
 	}
-}
\ No newline at end of file
+	indicatorConstraints.resize(kept);
+	indicatorTags.resize(kept);
+	model->update();
+}